@@ -0,0 +1,114 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+/* Compares the substring search kernels on a synthetic corpus of 100k
+   package descriptions against the search they replaced, which copied
+   each attribute, lowercased the copy and ran std::string::find on it.
+   The kernels search the folded copies, as in PackageStore::getfolded(). */
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "src/textsearch.h"
+
+using std::string;
+using std::vector;
+
+typedef std::chrono::steady_clock Clock;
+
+static vector<string> corpus(size_t n)
+{
+    static const char *words[] = {
+        "library", "tools", "gnome", "kde", "python", "bindings", "for",
+        "the", "a", "and", "of", "utility", "daemon", "plugin", "fast",
+        "lightweight", "X11", "Wayland", "terminal", "editor", "audio",
+        "video", "codec", "network", "manager", "server", "client", "GTK",
+        "Qt", "development", "files", "documentation", "extensions", "GNOME"
+    };
+    const size_t nwords = sizeof(words) / sizeof(words[0]);
+
+    std::mt19937 rng(42);
+    vector<string> v;
+
+    for (size_t i = 0; i < n; i++) {
+        string s = "pkg" + std::to_string(i) + " ";
+        const size_t len = 4 + rng() % 12;
+        for (size_t j = 0; j < len; j++) {
+            s += words[rng() % nwords];
+            s += " ";
+        }
+        v.push_back(s);
+    }
+
+    return v;
+}
+
+template <typename Fn>
+static void run(const char *name, const vector<string> &haystacks,
+                const vector<string> &needles, Fn contains)
+{
+    const int rounds = 20;
+    size_t hits = 0;
+
+    const Clock::time_point start = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const string &needle : needles) {
+            for (const string &h : haystacks) {
+                hits += contains(h, needle);
+            }
+        }
+    }
+    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    printf("%-12s %10.3f ms/query %12zu hits\n", name,
+           ms / (rounds * needles.size()), hits / rounds);
+}
+
+int main()
+{
+    const vector<string> originals = corpus(100000);
+    vector<string> haystacks;
+    for (const string &s : originals) {
+        haystacks.push_back(boost::to_lower_copy(s));
+    }
+    const vector<string> needles = {
+        "gnome", "x", "qt", "python bindings", "wayland", "notpresent", "pkg9999"
+    };
+
+    printf("%zu packages, selected kernel: %s\n", haystacks.size(), TextSearch::kernelname());
+
+    run("baseline", originals, needles, [] (const string &h, const string &n) {
+        string str = h;
+        boost::to_lower(str);
+        return str.find(n) != string::npos;
+    });
+    run("find", haystacks, needles, [] (const string &h, const string &n) {
+        return h.find(n) != string::npos;
+    });
+    run("scalar", haystacks, needles, [] (const string &h, const string &n) {
+        return TextSearch::containsscalar(h.data(), h.length(), n.data(), n.length());
+    });
+    run(TextSearch::kernelname(), haystacks, needles, [] (const string &h, const string &n) {
+        return TextSearch::contains(h, n);
+    });
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* A fixed number of bits, stored 64 to a word so that sets can be
+   combined a word at a time. Bits past size() are always clear. */
+class Bitset
+{
+public:
+    explicit Bitset(size_t n = 0, bool value = false)
+    {
+        assign(n, value);
+    }
+
+    void assign(size_t n, bool value)
+    {
+        bits = n;
+        words.assign((n + 63) / 64, value ? ~(uint64_t)0 : 0);
+        trim();
+    }
+
+    size_t size() const
+    {
+        return bits;
+    }
+
+    bool test(size_t i) const
+    {
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    void set(size_t i)
+    {
+        words[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+
+    void reset(size_t i)
+    {
+        words[i / 64] &= ~((uint64_t)1 << (i % 64));
+    }
+
+    /* number of set bits */
+    size_t count() const
+    {
+        size_t n = 0;
+        for (uint64_t w : words) {
+            n += __builtin_popcountll(w);
+        }
+        return n;
+    }
+
+    /* the following require both sets to have the same size */
+    Bitset &operator&=(const Bitset &other)
+    {
+        for (size_t i = 0; i < words.size(); i++) {
+            words[i] &= other.words[i];
+        }
+        return *this;
+    }
+
+    Bitset &operator|=(const Bitset &other)
+    {
+        for (size_t i = 0; i < words.size(); i++) {
+            words[i] |= other.words[i];
+        }
+        return *this;
+    }
+
+    void flip()
+    {
+        for (uint64_t &w : words) {
+            w = ~w;
+        }
+        trim();
+    }
+
+    /* Calls f(i) for every set bit i in ascending order. */
+    template <typename F>
+    void foreach(F f) const
+    {
+        for (size_t i = 0; i < words.size(); i++) {
+            for (uint64_t w = words[i]; w != 0; w &= w - 1) {
+                f(i * 64 + __builtin_ctzll(w));
+            }
+        }
+    }
+
+private:
+    void trim()
+    {
+        if (bits % 64 != 0) {
+            words.back() &= ((uint64_t)1 << (bits % 64)) - 1;
+        }
+    }
+
+    std::vector<uint64_t> words;
+    size_t bits;
+};
+
+#endif // BITSET_H
@@ -19,11 +19,13 @@
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/xpressive/xpressive.hpp>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 
 #include "globals.h"
 #include "pcursesexception.h"
+#include "profiler.h"
 
 using std::string;
 using std::vector;
@@ -34,6 +36,13 @@ using boost::xpressive::sregex;
 using boost::xpressive::smatch;
 using boost::xpressive::regex_constants::icase;
 
+/* the fixed grammars of both config files, compiled once */
+static const sregex confvalue = sregex::compile("\\w+.*?=\\s*(.+?)\\s*$");
+static const sregex confmacro = sregex::compile("^([^#]\\w*?)=(.+)$");
+static const sregex confoption = sregex::compile("^set\\s+(\\w+)\\s*=\\s*(.*?)\\s*$");
+static const sregex confcomment = sregex::compile("^#");
+static const sregex confsection = sregex::compile("^\\[(\\w+)\\].*$");
+
 Config::Config()
 {
     pacmanconffile = "/etc/pacman.conf";
@@ -41,6 +50,14 @@ Config::Config()
     rootdir = "/";
     dbpath = "/var/lib/pacman";
     logfile = "/var/log/pacman.log";
+
+    const char *xdgcache = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if (xdgcache != NULL && *xdgcache != '\0') {
+        cachefile = string(xdgcache) + "/" APPLICATION_NAME "/packages.cache";
+    } else if (home != NULL && *home != '\0') {
+        cachefile = string(home) + "/.cache/" APPLICATION_NAME "/packages.cache";
+    }
 }
 
 Config::~Config()
@@ -49,23 +66,41 @@ Config::~Config()
 
 string Config::getconfvalue(const string str) const
 {
-    sregex rex = sregex::compile("\\w+.*?=\\s*(.+?)\\s*$");
     smatch what;
 
-    if (regex_match(str, what, rex)) {
+    if (regex_match(str, what, confvalue)) {
         return what[1];
     } else {
         return "";
     }
 }
 
+unsigned long Config::getnumoption(const string &name, unsigned long def) const
+{
+    map<string, string>::const_iterator it = options.find(name);
+    if (it == options.end()) {
+        return def;
+    }
+
+    char *end;
+    const unsigned long value = strtoul(it->second.c_str(), &end, 10);
+    if (it->second.empty() || *end != '\0') {
+        throw PcursesException("Invalid value for option " + name + ": " + it->second);
+    }
+
+    return value;
+}
+
 void Config::parse_pcursesconf()
 {
+    Profiler::Timer timer("config: pcurses.conf");
     std::ifstream conf;
-    sregex macro = sregex::compile("^([^#]\\w*?)=(.+)$");
-    sregex comment = sregex::compile("^#");
     smatch what;
 
+    /* we might be reparsing on reload */
+    macros.clear();
+    options.clear();
+
     conf.open(pcursesconffile.c_str());
     if (!conf.is_open()) {
         /* ignore missing conf file */
@@ -80,9 +115,11 @@ void Config::parse_pcursesconf()
             continue;
         }
 
-        if (regex_match(line, what, comment)) {
+        if (regex_match(line, what, confcomment)) {
             continue;
-        } else if (regex_match(line, what, macro)) {
+        } else if (regex_match(line, what, confoption)) {
+            options[what[1]] = what[2];
+        } else if (regex_match(line, what, confmacro)) {
             macros.insert(std::pair<string, string>(what[1], what[2]));
         }
     }
@@ -90,11 +127,11 @@ void Config::parse_pcursesconf()
 
 void Config::parse_pacmanconf()
 {
+    Profiler::Timer timer("config: pacman.conf");
     const string s_rootdir = "RootDir",
                  s_dbpath = "DBPath",
                  s_logfile = "LogFile";
     std::ifstream conf;
-    sregex secrex = sregex::compile("^\\[(\\w+)\\].*$");
     smatch what;
 
     conf.open(pacmanconffile.c_str());
@@ -102,6 +139,9 @@ void Config::parse_pacmanconf()
         throw PcursesException("pacman.conf could not be read.");
     }
 
+    /* we might be reparsing on reload */
+    repos.clear();
+
     ConfSection section = CS_NONE;
     while (conf.good()) {
         string line;
@@ -111,7 +151,7 @@ void Config::parse_pacmanconf()
             continue;
         }
 
-        if (regex_match(line, what, secrex)) {
+        if (regex_match(line, what, confsection)) {
             if (what[1] == "options") {
                 section = CS_OPTIONS;
                 continue;
@@ -61,6 +61,12 @@ public:
         return logfile;
     }
 
+    /* Location of the package snapshot, empty if no cache dir is known. */
+    std::string getcachefile() const
+    {
+        return cachefile;
+    }
+
     std::vector<std::string> getrepos() const
     {
         return repos;
@@ -71,6 +77,10 @@ public:
         return macros;
     }
 
+    /* Numeric option set by a "set name=value" line in pcurses.conf, def
+       if it is not set. Throws if the value is not a number. */
+    unsigned long getnumoption(const std::string &name, unsigned long def) const;
+
 private:
 
     std::string getconfvalue(const std::string) const;
@@ -79,11 +89,13 @@ private:
         pcursesconffile,
         rootdir,
         dbpath,
-        logfile;
+        logfile,
+        cachefile;
 
     std::vector<std::string> repos;
 
-    std::map<std::string, std::string> macros;
+    std::map<std::string, std::string> macros,
+        options;
 
     enum ConfSection {
         CS_NONE,
@@ -103,7 +103,7 @@ void CursesFrame::refresh()
     wnoutrefresh(w_main);
 }
 
-void CursesFrame::printw(string str, int attr)
+void CursesFrame::printw(const string &str, int attr)
 {
     if (attr != 0) {
         wattron(w_main, attr);
@@ -114,7 +114,7 @@ void CursesFrame::printw(string str, int attr)
     }
 }
 
-void CursesFrame::mvprintw(int x, int y, string str, int attr)
+void CursesFrame::mvprintw(int x, int y, const string &str, int attr)
 {
     if (attr != 0) {
         wattron(w_main, attr);
@@ -44,8 +44,8 @@ public:
     void setheader(std::string str);
     void setfooter(std::string str);
     virtual void refresh();
-    void printw(std::string str, int attr = 0);
-    void mvprintw(int x, int y, std::string str, int attr = 0);
+    void printw(const std::string &str, int attr = 0);
+    void mvprintw(int x, int y, const std::string &str, int attr = 0);
     void move(int x, int y);
     void clear();
     void setfocused(bool b)
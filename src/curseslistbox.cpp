@@ -19,20 +19,20 @@
 
 #include <boost/format.hpp>
 
-#include "package.h"
-
 using std::vector;
 
 CursesListBox::CursesListBox(FrameInfo *frameinfo)
     : CursesFrame(frameinfo),
+      store(NULL),
       list(NULL),
       windowpos(0),
       cursorpos(0)
 {
 }
 
-void CursesListBox::setlist(vector<Package *> *l)
+void CursesListBox::setlist(const PackageStore *s, vector<PkgId> *l)
 {
+    store = s;
     list = l;
     updatefocus();
 }
@@ -148,21 +148,22 @@ int CursesListBox::focusedindex() const
     return windowpos + cursorpos;
 }
 
-Package *CursesListBox::focusedpackage() const
+bool CursesListBox::focusedpackage(PkgId &id) const
 {
     if (list->size() == 0) {
-        return NULL;
+        return false;
     }
     if (!isinbounds(focusedindex())) {
-        return NULL;
+        return false;
     }
 
-    return list->at(focusedindex());
+    id = list->at(focusedindex());
+    return true;
 }
 
 void CursesListBox::refresh()
 {
-    Package *pkg;
+    PkgId pkg;
 
     setheader(boost::str(boost::format("(%d)") % list->size()));
 
@@ -173,12 +174,12 @@ void CursesListBox::refresh()
 
         pkg = list->at(windowpos + i);
 
-        int attr = getcol(pkg->getcolindex());
+        int attr = getcol(store->getcolindex(pkg));
         if (i == cursorpos) {
             attr |= A_REVERSE;
         }
 
-        mvprintw(0, i, pkg->getname().substr(0, usablewidth() + 1), attr);
+        mvprintw(0, i, store->getname(pkg).substr(0, usablewidth() + 1), attr);
     }
 
     CursesFrame::refresh();
@@ -21,15 +21,14 @@
 #include <vector>
 
 #include "cursesframe.h"
-
-class Package;
+#include "packagestore.h"
 
 class CursesListBox : public CursesFrame
 {
 public:
     CursesListBox(FrameInfo *frameinfo);
 
-    void setlist(std::vector<Package *> *l);
+    void setlist(const PackageStore *s, std::vector<PkgId> *l);
     bool empty() const
     {
         return (list == NULL) || list->empty();
@@ -38,7 +37,9 @@ public:
     void movetoend();
     void moveabs(int pos);
     int focusedindex() const;
-    Package *focusedpackage() const;
+
+    /* Returns false if the list is empty. */
+    bool focusedpackage(PkgId &id) const;
     void removeselected();
     virtual void refresh();
 
@@ -48,7 +49,8 @@ protected:
     void updatefocus();
     chtype getcol(int index) const;
 
-    std::vector<Package *> *list;
+    const PackageStore *store;
+    std::vector<PkgId> *list;
     int windowpos,
         cursorpos;
 };
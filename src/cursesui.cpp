@@ -27,7 +27,6 @@
 #include "curseslistbox.h"
 #include "frameinfo.h"
 #include "globals.h"
-#include "package.h"
 #include "pcursesexception.h"
 #include "state.h"
 
@@ -117,8 +116,10 @@ void CursesUi::handle_resize(const State &state)
     update_display(state);
 }
 
-void CursesUi::enable_curses(vector<Package *> *pkgs, vector<Package *> *queue)
+void CursesUi::enable_curses(const PackageStore *s, vector<PkgId> *pkgs, vector<PkgId> *queue)
 {
+    store = s;
+
     if (system("clear") == -1) {
         throw PcursesException("system() failed");
     }
@@ -173,8 +174,8 @@ void CursesUi::enable_curses(vector<Package *> *pkgs, vector<Package *> *queue)
     help_pane->setbackground(C_DEF);
 
     set_focus(PANE_LIST);
-    list_pane->setlist(pkgs);
-    queue_pane->setlist(queue);
+    list_pane->setlist(store, pkgs);
+    queue_pane->setlist(store, queue);
 }
 
 void CursesUi::disable_curses()
@@ -197,7 +198,7 @@ void CursesUi::disable_curses()
     }
 }
 
-void CursesUi::printinfosection(AttributeEnum attr, string text)
+void CursesUi::printinfosection(AttributeEnum attr, const string &text)
 {
     string caption = AttributeInfo::attrname(attr);
     char hllower = AttributeInfo::attrtochar(attr);
@@ -234,7 +235,7 @@ void CursesUi::update_display(const State &state)
      */
 
     if (state.mode == MODE_INPUT || state.mode == MODE_STANDARD) {
-        Package *pkg;
+        PkgId pkg;
 
         erase();
         list_pane->clear();
@@ -244,11 +245,10 @@ void CursesUi::update_display(const State &state)
         queue_pane->clear();
 
         /* info pane */
-        pkg = focused_pane->focusedpackage();
-        if (pkg) {
+        if (focused_pane->focusedpackage(pkg)) {
             for (int i = 0; i < A_NONE; i++) {
                 AttributeEnum attr = (AttributeEnum)i;
-                string txt = pkg->getattr(attr);
+                const string &txt = store->getattr(pkg, attr);
                 if (txt.length() != 0) {
                     printinfosection(attr, txt);
                 }
@@ -257,12 +257,20 @@ void CursesUi::update_display(const State &state)
 
         /* status bar */
         status_pane->mvprintw(1, 0, "Sorted by: ", C_INV_HL1);
-        status_pane->printw(AttributeInfo::attrname(state.sortedby), C_INV);
+        status_pane->printw(state.sortedby.name(), C_INV);
         status_pane->printw(" Colored by: ", C_INV_HL1);
         status_pane->printw(AttributeInfo::attrname(state.coloredby), C_INV);
         status_pane->printw(" Filtered by: ", C_INV_HL1);
         status_pane->printw(((state.searchphrases.length() == 0)
                              ? "-" : state.searchphrases), C_INV);
+        if (!state.loadprogress.empty()) {
+            status_pane->printw(" Reading: ", C_INV_HL1);
+            status_pane->printw(state.loadprogress, C_INV);
+        }
+        if (!state.error.empty()) {
+            status_pane->printw(" Error: ", C_INV_HL1);
+            status_pane->printw(state.error, C_INV);
+        }
 
         wnoutrefresh(stdscr);
         list_pane->refresh();
@@ -298,6 +306,8 @@ void CursesUi::print_help()
     PRINTH("", "   note that filters can be chained.\n")
     PRINTH("n: ", "filter packages by name (using regexp)\n");
     PRINTH("c: ", "clear all package filters\n");
+    PRINTH("u: ", "undo the last package filter\n");
+    PRINTH("e: ", "edit a package filter, up/down arrows pick an earlier/later one\n");
     PRINTH("C: ", "clear the package queue\n");
     PRINTH("?: ", "search packages\n");
     PRINTH(".: ", "sort packages by specified field\n");
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "attributeinfo.h"
+#include "packagestore.h"
 
 enum PaneEnum {
     PANE_LIST,
@@ -29,7 +30,6 @@ enum PaneEnum {
 
 class CursesListBox;
 class CursesFrame;
-class Package;
 class State;
 
 class CursesUi
@@ -38,7 +38,8 @@ public:
     static CursesUi &ui();
 
     /* Enable ncurses handling of the console. */
-    void enable_curses(std::vector<Package *> *pkgs, std::vector<Package *> *queue);
+    void enable_curses(const PackageStore *store, std::vector<PkgId> *pkgs,
+                       std::vector<PkgId> *queue);
 
     /* Disable ncurses handling of the console. */
     void disable_curses();
@@ -77,7 +78,7 @@ private:
     void resize();
 
     void print_help();
-    void printinfosection(AttributeEnum attr, std::string text);
+    void printinfosection(AttributeEnum attr, const std::string &text);
 
     /* Throws exception if terminal size is below a fixed limit. */
     void ensure_min_term_size(uint w, uint h) const;
@@ -89,6 +90,8 @@ private:
                   *queue_pane,
                   *focused_pane;
 
+    const PackageStore *store;
+
     CursesFrame *info_pane,
                 *input_pane,
                 *help_pane,
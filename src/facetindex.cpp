@@ -0,0 +1,115 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "facetindex.h"
+
+#include <boost/algorithm/string.hpp>
+#include <unordered_map>
+
+#include "textsearch.h"
+
+using boost::xpressive::smatch;
+using boost::xpressive::sregex;
+using std::string;
+using std::vector;
+
+void FacetIndex::build(const vector<const string *> &column, bool split)
+{
+    clear();
+
+    /* most values are interned or static, so equal values usually share
+       a pointer and are only compared by content once */
+    std::unordered_map<const string *, size_t> bypointer;
+    std::unordered_map<string, size_t> byvalue;
+
+    for (uint32_t id = 0; id < column.size(); id++) {
+        const string *s = column[id];
+
+        auto it = bypointer.find(s);
+        if (it == bypointer.end()) {
+            auto inserted = byvalue.insert(std::make_pair(*s, values.size()));
+            if (inserted.second) {
+                Value v;
+                v.str = *s;
+                v.folded = boost::to_lower_copy(*s);
+                v.bits.assign(column.size(), false);
+                values.push_back(v);
+            }
+            it = bypointer.insert(std::make_pair(s, inserted.first->second)).first;
+        }
+
+        values[it->second].bits.set(id);
+    }
+
+    for (const Value &v : values) {
+        vector<string> keys;
+        if (split) {
+            boost::split(keys, v.folded, boost::is_any_of(" "), boost::token_compress_on);
+        } else {
+            keys.push_back(v.folded);
+        }
+
+        for (const string &key : keys) {
+            if (split && key.empty()) {
+                continue;
+            }
+
+            auto it = items.find(key);
+            if (it == items.end()) {
+                it = items.insert(std::make_pair(key, Bitset(column.size()))).first;
+            }
+            it->second |= v.bits;
+        }
+    }
+
+    built = true;
+}
+
+void FacetIndex::clear()
+{
+    values.clear();
+    items.clear();
+    built = false;
+}
+
+void FacetIndex::contains(const string &needle, Bitset &out) const
+{
+    for (const Value &v : values) {
+        if (TextSearch::contains(v.folded, needle)) {
+            out |= v.bits;
+        }
+    }
+}
+
+void FacetIndex::search(const sregex &re, Bitset &out) const
+{
+    smatch what;
+
+    for (const Value &v : values) {
+        if (regex_search(v.str, what, re)) {
+            out |= v.bits;
+        }
+    }
+}
+
+void FacetIndex::equals(const string &needle, Bitset &out) const
+{
+    auto it = items.find(needle);
+    if (it != items.end()) {
+        out |= it->second;
+    }
+}
@@ -0,0 +1,68 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef FACETINDEX_H
+#define FACETINDEX_H
+
+#include <boost/xpressive/xpressive.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "bitset.h"
+
+/* Groups the strings of a column with few distinct values, such as repo
+   or install state, by value. A phrase is then matched against every
+   distinct value once instead of against every string, and the bitsets
+   of the matching values are combined a word at a time. Exact lookups
+   use one bitset per item for columns holding space separated lists
+   such as groups and licenses. */
+class FacetIndex
+{
+public:
+    FacetIndex() : built(false) { }
+
+    /* column[i] is the value of string i. */
+    void build(const std::vector<const std::string *> &column, bool split);
+
+    void clear();
+
+    bool isbuilt() const
+    {
+        return built;
+    }
+
+    /* The following set the bits of all strings matching in out, which
+       must have one bit per string of the column. needle is lowercase. */
+    void contains(const std::string &needle, Bitset &out) const;
+    void search(const boost::xpressive::sregex &re, Bitset &out) const;
+    /* strings equal to needle, or with an item equal to needle if split */
+    void equals(const std::string &needle, Bitset &out) const;
+
+private:
+    struct Value {
+        std::string str,
+            folded;
+        Bitset bits;
+    };
+
+    std::vector<Value> values;
+    std::map<std::string, Bitset> items;
+    bool built;
+};
+
+#endif // FACETINDEX_H
@@ -20,7 +20,8 @@
 #include <algorithm>
 #include <boost/algorithm/string.hpp>
 
-#include "package.h"
+#include "pcursesexception.h"
+#include "textsearch.h"
 
 using boost::xpressive::smatch;
 using boost::xpressive::sregex;
@@ -34,6 +35,12 @@ using std::string;
 vector<AttributeEnum> Filter::attrlist;
 map<string, int> Filter::groups;
 
+/* "[attributes][!]:phrase" or "[attributes][!]=phrase", see parse() */
+static const sregex reprefix = sregex::compile("^(([A-Za-zq]*)([!]?)([:=]))?(.*)");
+
+/* see issimple() */
+static const sregex resimple = sregex::compile("[[:alnum:]]+");
+
 void Filter::clearattrs()
 {
     Filter::attrlist.clear();
@@ -47,9 +54,13 @@ void Filter::clearattrs()
 
 void Filter::setattrs(string s)
 {
-    AttributeEnum attr;
+    Filter::attrlist = parseattrs(s);
+}
 
-    Filter::attrlist.clear();
+vector<AttributeEnum> Filter::parseattrs(const string &s)
+{
+    AttributeEnum attr;
+    vector<AttributeEnum> attrs;
 
     for (uint i = 0; i < s.length(); i++) {
         attr = AttributeInfo::chartoattr(s[i]);
@@ -57,17 +68,75 @@ void Filter::setattrs(string s)
         if (attr == A_NONE) {
             continue;
         }
-        if (find(Filter::attrlist.begin(), Filter::attrlist.end(), attr) != Filter::attrlist.end()) {
+        if (std::find(attrs.begin(), attrs.end(), attr) != attrs.end()) {
             continue;
         }
 
-        Filter::attrlist.push_back(attr);
+        attrs.push_back(attr);
+    }
+
+    return attrs;
+}
+
+void Filter::parse(const string &str, string &fieldlist, bool &negate, bool &exact,
+                   string &phrase)
+{
+    smatch what;
+
+    if (!regex_search(str, what, reprefix)) {
+        throw PcursesException("Could not match filter regex.");
+    }
+
+    fieldlist = what[2];
+    negate = (what[3] == "!");
+    exact = (what[4] == "=");
+    phrase = what[5];
+}
+
+string Filter::normalize(const string &str)
+{
+    string fieldlist, phrase;
+    bool negate, exact;
+
+    parse(str, fieldlist, negate, exact, phrase);
+
+    /* attributes are matched in any order, see setattrs() and
+       clearattrs() for the defaults */
+    vector<bool> used(A_NONE, false);
+    if (fieldlist.empty()) {
+        used[A_NAME] = used[A_DESC] = true;
+    }
+    for (char c : fieldlist) {
+        const AttributeEnum attr = AttributeInfo::chartoattr(c);
+        if (attr != A_NONE) {
+            used[attr] = true;
+        }
+    }
+
+    string normalized;
+    for (int attr = 0; attr < A_NONE; attr++) {
+        if (used[attr]) {
+            normalized += AttributeInfo::attrtochar((AttributeEnum)attr);
+        }
+    }
+
+    if (exact || issimple(phrase)) {
+        boost::to_lower(phrase);
     }
+
+    return normalized + (negate ? "!" : "") + (exact ? "=" : ":") + phrase;
+}
+
+bool Filter::issimple(const string &phrase)
+{
+    smatch what;
+
+    return regex_match(phrase, what, resimple);
 }
 
-void Filter::assigncol(Package *a, AttributeEnum attr)
+void Filter::assigncol(PackageStore &store, PkgId a, AttributeEnum attr)
 {
-    string s = a->getattr(attr);
+    const string &s = store.getattr(a, attr);
     int colindex;
 
     map<string, int>::iterator it = groups.find(s);
@@ -79,53 +148,165 @@ void Filter::assigncol(Package *a, AttributeEnum attr)
         groups[s] = colindex;
     }
 
-    a->setcolindex(colindex);
+    store.setcolindex(a, colindex);
+}
+
+bool Filter::matches(const PackageStore &store, PkgId a, const string &needle)
+{
+    return !notmatches(store, a, needle);
+}
+
+bool Filter::matchesre(const PackageStore &store, PkgId a, const sregex &needle)
+{
+    return !notmatchesre(store, a, needle);
 }
 
-bool Filter::matches(const Package *a, const string needle)
+bool Filter::notmatchesre(const PackageStore &store, PkgId a, const sregex &needle)
 {
-    return !notmatches(a, needle);
+    return !matchesre(store, a, Filter::attrlist, needle);
 }
 
-bool Filter::matchesre(const Package *a, const sregex needle)
+bool Filter::notmatches(const PackageStore &store, PkgId a, const string &needle)
 {
-    return !notmatchesre(a, needle);
+    return !matches(store, a, Filter::attrlist, needle);
 }
 
-bool Filter::notmatchesre(const Package *a, const sregex needle)
+bool Filter::matchesre(const PackageStore &store, PkgId a, const vector<AttributeEnum> &attrs,
+                       const sregex &needle)
 {
-    bool found = false;
     smatch what;
 
-    for (uint i = 0; i < Filter::attrlist.size(); i++) {
-        found = found || regex_search(a->getattr(Filter::attrlist[i]), what, needle);
+    for (uint i = 0; i < attrs.size(); i++) {
+        if (regex_search(store.getattr(a, attrs[i]), what, needle)) {
+            return true;
+        }
     }
 
-    return !found;
+    return false;
 }
 
-bool Filter::notmatches(const Package *a, const string needle)
+bool Filter::matches(const PackageStore &store, PkgId a, const vector<AttributeEnum> &attrs,
+                     const string &needle)
 {
-    bool found = false;
-    string str;
+    for (uint i = 0; i < attrs.size(); i++) {
+        if (TextSearch::contains(store.getfolded(a, attrs[i]), needle)) {
+            return true;
+        }
+    }
+
+    return false;
+}
 
-    string lneedle = needle;
-    boost::to_lower(lneedle);
+bool Filter::equals(const PackageStore &store, PkgId a, const vector<AttributeEnum> &attrs,
+                    const string &needle)
+{
+    for (uint i = 0; i < attrs.size(); i++) {
+        if (store.getfolded(a, attrs[i]) == needle) {
+            return true;
+        }
+    }
 
-    for (uint i = 0; i < Filter::attrlist.size(); i++) {
-        str = a->getattr(Filter::attrlist[i]);
-        boost::to_lower(str);
-        found = found || str.find(lneedle) != std::string::npos;
+    return false;
+}
+
+bool Filter::candidates(const PackageStore &store, const string &needle,
+                        vector<bool> &mask)
+{
+    return candidates(store, Filter::attrlist, needle, mask);
+}
+
+bool Filter::candidates(const PackageStore &store, const vector<AttributeEnum> &attrs,
+                        const string &needle, vector<bool> &mask)
+{
+    mask.assign(store.size(), false);
+
+    for (uint i = 0; i < attrs.size(); i++) {
+        if (!store.gettrigrams(attrs[i]).candidates(needle, mask)) {
+            return false;
+        }
     }
 
-    return !found;
+    return true;
+}
+
+void Filter::prepare(const PackageStore &store, bool folded)
+{
+    for (uint i = 0; i < Filter::attrlist.size(); i++) {
+        store.prepare(Filter::attrlist[i], folded);
+    }
 }
 
-bool Filter::cmp(const Package *lhs, const Package *rhs, AttributeEnum attr)
+void Filter::sortby(const PackageStore &store, vector<PkgId> &list, const SortSpec &spec)
 {
-    if (attr == A_SIZE || attr == A_ISIZE || attr == A_BUILDDATE) {
-        return lhs->getoffattr(attr) < rhs->getoffattr(attr);
+    const vector<SortSpec::Key> &keys = spec.getkeys();
+    const uint64_t limit = (uint64_t)1 << 32;
+
+    /* ranks and number of distinct values of each key */
+    vector<const vector<uint32_t> *> ranks(keys.size());
+    vector<uint64_t> counts(keys.size());
+    for (size_t k = 0; k < keys.size(); k++) {
+        const vector<PkgId> &sorted = store.getsorted(keys[k].attr);
+        ranks[k] = &store.getranks(keys[k].attr);
+        counts[k] = sorted.empty() ? 1 : (*ranks[k])[sorted.back()] + 1;
+    }
+
+    /* groups of keys are sorted by least significant first, which the
+       stable passes keep as the order within the more significant ones */
+    vector<uint64_t> items(list.size());
+    size_t end = keys.size();
+    while (end > 0) {
+        uint64_t range = 1;
+        size_t begin = end;
+        while (begin > 0 && (begin == end || counts[begin - 1] <= limit / range)) {
+            range *= counts[begin - 1];
+            begin--;
+        }
+
+        /* the keys of the group as digits of one number, id below it */
+        for (size_t i = 0; i < list.size(); i++) {
+            uint64_t value = 0;
+            for (size_t k = begin; k < end; k++) {
+                const uint32_t rank = (*ranks[k])[list[i]];
+                value = value * counts[k] + (keys[k].descending ? counts[k] - 1 - rank : rank);
+            }
+            items[i] = (value << 32) | list[i];
+        }
+
+        unsigned bits = 0;
+        while (bits < 32 && ((uint64_t)1 << bits) < range) {
+            bits++;
+        }
+        radixsort(items, bits);
+
+        for (size_t i = 0; i < list.size(); i++) {
+            list[i] = (PkgId)items[i];
+        }
+        end = begin;
     }
+}
+
+void Filter::radixsort(vector<uint64_t> &keys, unsigned bits)
+{
+    /* as few digits of at most 16 bits as possible */
+    const unsigned passes = (bits + 15) / 16;
+    const unsigned width = (passes == 0) ? 1 : (bits + passes - 1) / passes;
+    const uint64_t mask = ((uint64_t)1 << width) - 1;
 
-    return lhs->getattr(attr) < rhs->getattr(attr);
+    /* least significant digit first, each pass keeps the order of keys
+       with equal digits */
+    vector<uint64_t> next(keys.size());
+    vector<size_t> counts;
+    for (unsigned shift = 32; shift < 32 + bits; shift += width) {
+        counts.assign(mask + 2, 0);
+        for (uint64_t k : keys) {
+            counts[((k >> shift) & mask) + 1]++;
+        }
+        for (size_t d = 1; d < counts.size(); d++) {
+            counts[d] += counts[d - 1];
+        }
+        for (uint64_t k : keys) {
+            next[counts[(k >> shift) & mask]++] = k;
+        }
+        keys.swap(next);
+    }
 }
@@ -19,12 +19,14 @@
 #define FILTER_H
 
 #include <boost/xpressive/xpressive.hpp>
+#include <cstdint>
 #include <map>
 #include <vector>
 
 #include "attributeinfo.h"
-
-class Package;
+#include "packagestore.h"
+#include "parallel.h"
+#include "sortspec.h"
 
 class Filter
 {
@@ -32,17 +34,161 @@ public:
     static void setattrs(std::string s);
     static void clearattrs();
 
-    static bool cmp(const Package *lhs, const Package *rhs, AttributeEnum attr);
-    static bool matchesre(const Package *a,
-                          const boost::xpressive::sregex needle);
-    static bool matches(const Package *a, const std::string needle);
-    static bool notmatchesre(const Package *a,
-                             const boost::xpressive::sregex needle);
-    static bool notmatches(const Package *a, const std::string needle);
+    /* The attributes of a field list, each listed once. */
+    static std::vector<AttributeEnum> parseattrs(const std::string &s);
+
+    /* Splits a filter of the form "[attributes][!]:phrase", or
+       "[attributes][!]=phrase" for exact matches. */
+    static void parse(const std::string &str, std::string &fieldlist, bool &negate,
+                      bool &exact, std::string &phrase);
+
+    /* Returns a filter equivalent to str which is the same for all
+       spellings of it: attributes are listed once each in a fixed order,
+       simple and exact phrases are lowercase. */
+    static std::string normalize(const std::string &str);
+
+    /* Alphanumeric phrases are matched as plain substrings, everything else
+       as a case insensitive regex. */
+    static bool issimple(const std::string &phrase);
+
+    /* Sorts list by all keys of spec, keeping the order of packages equal
+       in all of them. The ranks of the store (see PackageStore::getranks())
+       of as many keys as fit are combined into one number per package,
+       which is then radix sorted, so that a spec of few keys is sorted in
+       a single pass. */
+    static void sortby(const PackageStore &store, std::vector<PkgId> &list,
+                       const SortSpec &spec);
+
+    /* The following match against the current attributes, or against
+       attrs where given. */
+    static bool matchesre(const PackageStore &store, PkgId a,
+                          const boost::xpressive::sregex &needle);
+    static bool matchesre(const PackageStore &store, PkgId a,
+                          const std::vector<AttributeEnum> &attrs,
+                          const boost::xpressive::sregex &needle);
+    /* needle must be lowercase, see PackageStore::getfolded(). */
+    static bool matches(const PackageStore &store, PkgId a, const std::string &needle);
+    static bool matches(const PackageStore &store, PkgId a,
+                        const std::vector<AttributeEnum> &attrs, const std::string &needle);
+    /* True if any of attrs is needle (lowercase) as a whole. */
+    static bool equals(const PackageStore &store, PkgId a,
+                       const std::vector<AttributeEnum> &attrs, const std::string &needle);
+    static bool notmatchesre(const PackageStore &store, PkgId a,
+                             const boost::xpressive::sregex &needle);
+    static bool notmatches(const PackageStore &store, PkgId a, const std::string &needle);
+
+    /* Marks all packages which may match needle (lowercase) in any of the
+       attributes, using the trigram indices. Returns false if the needle
+       is too short for the index, mask is not usable then. */
+    static bool candidates(const PackageStore &store, const std::string &needle,
+                           std::vector<bool> &mask);
+    static bool candidates(const PackageStore &store, const std::vector<AttributeEnum> &attrs,
+                           const std::string &needle, std::vector<bool> &mask);
+
+    /* Returns the packages of in for which keep() holds, in their original
+       order. keep() is called exactly once per package. */
+    template <typename Pred>
+    static std::vector<PkgId> select(const std::vector<PkgId> &in, Pred keep)
+    {
+        std::vector<PkgId> out;
+        out.reserve(in.size());
+
+        for (PkgId p : in) {
+            if (keep(p)) {
+                out.push_back(p);
+            }
+        }
+
+        return out;
+    }
+
+    /* Like select() above, but lists of at least threshold packages are
+       split across worker threads. makekeep() is called once per thread
+       and returns the predicate of that thread, so that regexes are never
+       shared. The store must have been prepared first, see prepare(). */
+    template <typename MakePred>
+    static std::vector<PkgId> select(const std::vector<PkgId> &in, size_t threshold,
+                                     MakePred makekeep)
+    {
+        if (in.size() < std::max<size_t>(threshold, 1)) {
+            return select(in, makekeep());
+        }
 
-    static void assigncol(Package *a, AttributeEnum attr);
+        /* one slot per package, merged in order afterwards */
+        std::vector<char> kept(in.size());
+        parallel_for(in.size(), minslice, [&] (size_t begin, size_t end) {
+            auto keep = makekeep();
+            for (size_t i = begin; i < end; i++) {
+                kept[i] = keep(in[i]);
+            }
+        });
+
+        std::vector<PkgId> out;
+        out.reserve(in.size());
+        for (size_t i = 0; i < in.size(); i++) {
+            if (kept[i]) {
+                out.push_back(in[i]);
+            }
+        }
+
+        return out;
+    }
+
+    /* Returns the position of the first package of in for which keep()
+       holds, starting at from and wrapping around, or in.size() if there
+       is none. Lists of at least threshold packages are searched in blocks
+       of threshold packages, each split across worker threads; makekeep()
+       and the store as in select(). */
+    template <typename MakePred>
+    static size_t find(const std::vector<PkgId> &in, size_t from, size_t threshold,
+                       MakePred makekeep)
+    {
+        const size_t n = in.size();
+        threshold = std::max<size_t>(threshold, 1);
+
+        if (n < threshold) {
+            auto keep = makekeep();
+            for (size_t k = 0; k < n; k++) {
+                if (keep(in[(from + k) % n])) {
+                    return (from + k) % n;
+                }
+            }
+            return n;
+        }
+
+        std::vector<char> found(threshold);
+        for (size_t done = 0; done < n; done += threshold) {
+            const size_t len = std::min(threshold, n - done);
+            parallel_for(len, minslice, [&] (size_t begin, size_t end) {
+                auto keep = makekeep();
+                for (size_t k = begin; k < end; k++) {
+                    found[k] = keep(in[(from + done + k) % n]);
+                }
+            });
+
+            for (size_t k = 0; k < len; k++) {
+                if (found[k]) {
+                    return (from + done + k) % n;
+                }
+            }
+        }
+
+        return n;
+    }
+
+    /* Prepares the store for matching against the current attributes from
+       several threads, folded for matches(), else for matchesre(). */
+    static void prepare(const PackageStore &store, bool folded);
+
+    static void assigncol(PackageStore &store, PkgId a, AttributeEnum attr);
 
 private:
+    /* sorts keys by their upper 32 bits, of which only the lowest bits
+       are used */
+    static void radixsort(std::vector<uint64_t> &keys, unsigned bits);
+
+    /* smallest number of packages handed to a worker thread */
+    static const size_t minslice = 512;
 
     static std::vector<AttributeEnum> attrlist;
 
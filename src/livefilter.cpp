@@ -0,0 +1,167 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "livefilter.h"
+
+#include <algorithm>
+
+#include "pcursesexception.h"
+#include "profiler.h"
+
+using std::string;
+using std::vector;
+
+/* the input has to stay unchanged this long before it is evaluated */
+static const std::chrono::milliseconds delay(120);
+
+/* longest time a single step may take */
+static const std::chrono::milliseconds slice(8);
+
+/* packages matched between two looks at the clock */
+static const size_t batch = 256;
+
+LiveFilter::LiveFilter()
+    : pos(0),
+      isactive(false),
+      ispending(false),
+      isrunning(false)
+{
+}
+
+void LiveFilter::start(const vector<PkgId> &base)
+{
+    this->base = base;
+
+    /* base is what the empty input shows */
+    result = base;
+    input.clear();
+    resultinput.clear();
+    resultquery.reset();
+
+    isactive = true;
+    ispending = false;
+    isrunning = false;
+}
+
+void LiveFilter::stop()
+{
+    vector<PkgId>().swap(base);
+    vector<PkgId>().swap(result);
+    vector<PkgId>().swap(source);
+    vector<PkgId>().swap(selection);
+    query.reset();
+    resultquery.reset();
+
+    isactive = false;
+    ispending = false;
+    isrunning = false;
+}
+
+void LiveFilter::update(const string &str)
+{
+    if (!isactive || str == input) {
+        return;
+    }
+
+    input = str;
+    due = Clock::now() + delay;
+    ispending = true;
+    isrunning = false;
+}
+
+bool LiveFilter::done(const string &str) const
+{
+    return isactive && !ispending && !isrunning && resultinput == str;
+}
+
+bool LiveFilter::begin(const PackageStore &store)
+{
+    evaluated = input;
+
+    /* the filter is often incomplete while being typed, keep showing the
+       last result then */
+    try {
+        query.reset(new Query(store, evaluated));
+    } catch (const boost::xpressive::regex_error &e) {
+        return false;
+    } catch (const PcursesException &e) {
+        return false;
+    }
+
+    selection.clear();
+    source.clear();
+    pos = 0;
+
+    /* nothing to filter by, everything stays */
+    if (query->empty()) {
+        selection = base;
+        isrunning = true;
+        return true;
+    }
+
+    query->plan();
+    const bool narrow = (resultquery == nullptr || query->narrows(*resultquery));
+    source = narrow ? result : base;
+
+    isrunning = true;
+    return true;
+}
+
+bool LiveFilter::step(const PackageStore &store)
+{
+    if (!isactive) {
+        return false;
+    }
+
+    if (ispending) {
+        if (Clock::now() < due) {
+            return false;
+        }
+        ispending = false;
+        if (!begin(store)) {
+            return false;
+        }
+    }
+
+    if (!isrunning) {
+        return false;
+    }
+
+    Profiler::Timer timer("filter: live step");
+    const Clock::time_point deadline = Clock::now() + slice;
+
+    while (pos < source.size()) {
+        const size_t end = std::min(source.size(), pos + batch);
+        for (; pos < end; pos++) {
+            if (query->matches(source[pos])) {
+                selection.push_back(source[pos]);
+            }
+        }
+
+        if (pos < source.size() && Clock::now() >= deadline) {
+            return false;
+        }
+    }
+
+    result.swap(selection);
+    selection.clear();
+    resultinput = evaluated;
+    resultquery = std::move(query);
+
+    isrunning = false;
+    return true;
+}
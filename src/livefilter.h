@@ -0,0 +1,104 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef LIVEFILTER_H
+#define LIVEFILTER_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packagestore.h"
+#include "query.h"
+
+/* Filters the package list while the filter is being typed. Evaluation
+   starts once no key has been pressed for a short while and is done in
+   small time slices from the main loop, so that typing is never blocked.
+   If the new filter can only match fewer packages, e.g. because the
+   phrase only got longer, the last result is narrowed down instead of
+   going through the whole list again. */
+class LiveFilter
+{
+public:
+    LiveFilter();
+
+    /* Starts filtering base, the list shown before the filter is entered. */
+    void start(const std::vector<PkgId> &base);
+    void stop();
+
+    bool active() const
+    {
+        return isactive;
+    }
+
+    /* Called whenever the input changes. A running evaluation is
+       cancelled, the new one is started by step() after the delay. */
+    void update(const std::string &str);
+
+    /* Continues the evaluation for a few milliseconds at most. Returns
+       true if it has finished, result() is then up to date. */
+    bool step(const PackageStore &store);
+
+    /* True while an evaluation has been started but not finished. */
+    bool running() const
+    {
+        return isrunning;
+    }
+
+    /* True if result() holds the packages of base matching str. */
+    bool done(const std::string &str) const;
+
+    const std::vector<PkgId> &getbase() const
+    {
+        return base;
+    }
+
+    const std::vector<PkgId> &getresult() const
+    {
+        return result;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    bool begin(const PackageStore &store);
+
+    std::vector<PkgId> base,
+        result,
+        source,
+        selection;
+
+    /* the typed input, the input being evaluated and the input result
+       belongs to */
+    std::string input,
+        evaluated,
+        resultinput;
+
+    /* the filters of evaluated and resultinput, no result query means
+       that result is base */
+    std::unique_ptr<Query> query,
+        resultquery;
+
+    Clock::time_point due;
+    size_t pos;
+    bool isactive,
+         ispending,
+         isrunning;
+};
+
+#endif // LIVEFILTER_H
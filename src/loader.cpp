@@ -0,0 +1,225 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "loader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "parallel.h"
+#include "pcursesexception.h"
+#include "profiler.h"
+
+using std::string;
+using std::vector;
+
+typedef struct __alpm_list_t alpm_list_t;
+
+Loader::Loader()
+    : ndone(0),
+      ntotal(0),
+      running(false),
+      cancelled(false)
+{
+}
+
+Loader::~Loader()
+{
+    stop();
+}
+
+void Loader::start(const Config &conf)
+{
+    stop();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    error = std::exception_ptr();
+    ndone = 0;
+    ntotal = conf.getrepos().size() + 1;
+    running = true;
+    cancelled = false;
+    thread = std::thread(&Loader::run, this, conf);
+}
+
+void Loader::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+    }
+
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    for (LoadedDb &db : finished) {
+        db.store.clear();
+        alpm_release(db.handle);
+    }
+    finished.clear();
+    running = false;
+}
+
+bool Loader::busy() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return running || !finished.empty();
+}
+
+bool Loader::next(LoadedDb &db)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!finished.empty()) {
+        db = std::move(finished.front());
+        finished.pop_front();
+        return true;
+    }
+
+    if (error) {
+        std::exception_ptr e = error;
+        error = std::exception_ptr();
+        std::rethrow_exception(e);
+    }
+
+    return false;
+}
+
+string Loader::progress() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!running) {
+        return "";
+    }
+
+    return current + " (" + std::to_string(ndone + 1) + "/" + std::to_string(ntotal) + ")";
+}
+
+void Loader::run(Config conf)
+{
+    vector<string> dbs = conf.getrepos();
+    dbs.insert(dbs.begin(), "local");
+
+    try {
+        for (const string &name : dbs) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (cancelled) {
+                    break;
+                }
+                current = name;
+            }
+
+            LoadedDb db;
+            db.name = name;
+            db.handle = openhandle(conf, name);
+            read(db);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(std::move(db));
+            ndone++;
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+}
+
+alpm_handle_t *Loader::openhandle(const Config &conf, const string &db)
+{
+    _alpm_errno_t err;
+    alpm_handle_t *handle;
+
+    {
+        Profiler::Timer timer("alpm: initialize");
+        handle = alpm_initialize(conf.getrootdir().c_str(), conf.getdbpath().c_str(), &err);
+        if (handle == NULL) {
+            throw PcursesException(alpm_strerror(err));
+        }
+
+        alpm_option_set_logfile(handle, conf.getlogfile().c_str());
+    }
+
+    if (db != "local") {
+        Profiler::Timer timer("alpm: register syncdb");
+        /* i'm going to be lazy here and remind myself to handle siglevel properly later on */
+        alpm_register_syncdb(handle, db.c_str(), ALPM_SIG_USE_DEFAULT);
+    }
+
+    return handle;
+}
+
+alpm_db_t *Loader::getdb(alpm_handle_t *handle, const string &db)
+{
+    if (db == "local") {
+        return alpm_get_localdb(handle);
+    }
+
+    alpm_list_t *syncdbs = alpm_get_syncdbs(handle);
+    return (syncdbs == NULL) ? NULL : (alpm_db_t *)syncdbs->data;
+}
+
+void Loader::read(LoadedDb &db)
+{
+    alpm_db_t *alpmdb = getdb(db.handle, db.name);
+    if (alpmdb == NULL) {
+        throw PcursesException("Could not register db " + db.name + ".");
+    }
+
+    const bool local = (db.name == "local");
+    const RepoId repo = db.store.addrepo(db.name);
+
+    /* this loads the pkgcache, which libalpm does not do in a thread safe
+       way. the local index reads all local package details up front. */
+    vector<alpm_pkg_t *> pkgs;
+    {
+        Profiler::Timer timer("alpm: read pkgcache");
+        if (local) {
+            db.local.build(alpmdb);
+        }
+
+        for (alpm_list_t *i = alpm_db_get_pkgcache(alpmdb); i; i = alpm_list_next(i)) {
+            pkgs.push_back((alpm_pkg_t *)i->data);
+        }
+    }
+
+    /* the store is ordered by name */
+    {
+        Profiler::Timer timer("store: sort");
+        std::sort(pkgs.begin(), pkgs.end(), [] (alpm_pkg_t *lhs, alpm_pkg_t *rhs) {
+            return strcmp(alpm_pkg_get_name(lhs), alpm_pkg_get_name(rhs)) < 0;
+        });
+    }
+
+    /* every worker fills its own slice of the store, so the result does
+       not depend on scheduling. */
+    Profiler::Timer timer("store: construct packages");
+    db.store.resize(pkgs.size());
+    parallel_for(pkgs.size(), 256, [&] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            db.store.set(i, pkgs[i], repo);
+        }
+    });
+
+    if (local) {
+        db.store.setlocal(db.local);
+    }
+}
@@ -0,0 +1,97 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <alpm.h>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "localindex.h"
+#include "packagestore.h"
+
+/* A single db read by the Loader. The packages in store point into the
+   db, which is opened with a handle of its own. local is only filled in
+   for the local db. */
+struct LoadedDb {
+    LoadedDb() : handle(NULL) { }
+
+    std::string name;
+    alpm_handle_t *handle;
+    PackageStore store;
+    LocalIndex local;
+};
+
+/* Reads the local db followed by all sync dbs on a background thread.
+   Finished dbs are queued until the main thread picks them up with
+   next(). Packages of sync dbs do not have their install reason and
+   update state set yet, the local db is not shared with the loader once
+   it has been handed over. */
+class Loader
+{
+public:
+    Loader();
+    ~Loader();
+
+    void start(const Config &conf);
+
+    /* Cancels loading after the current db and releases everything which
+       has not been handed over yet. */
+    void stop();
+
+    /* True until the last db has been handed over. */
+    bool busy() const;
+
+    /* Hands over the next finished db, if any. Errors of the loader
+       thread are rethrown here. */
+    bool next(LoadedDb &db);
+
+    /* Short description of what is being read, empty if not busy. */
+    std::string progress() const;
+
+    /* Opens a handle for db, which is either a sync repo or "local". */
+    static alpm_handle_t *openhandle(const Config &conf, const std::string &db);
+
+    /* The db a handle returned by openhandle() was opened for. */
+    static alpm_db_t *getdb(alpm_handle_t *handle, const std::string &db);
+
+    /* Reads all packages of db. For the local db, this also builds its
+       index and sets install reason and update state, sync packages do not
+       have them set. */
+    static void read(LoadedDb &db);
+
+private:
+    void run(Config conf);
+
+    mutable std::mutex mutex;
+    std::thread thread;
+    std::deque<LoadedDb> finished;
+    std::exception_ptr error;
+    std::string current;
+    size_t ndone,
+           ntotal;
+    bool running,
+         cancelled;
+};
+
+#endif // LOADER_H
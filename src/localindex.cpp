@@ -0,0 +1,33 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "localindex.h"
+
+typedef struct __alpm_list_t alpm_list_t;
+
+void LocalIndex::build(alpm_db_t *localdb)
+{
+    pkgs.clear();
+
+    for (alpm_list_t *i = alpm_db_get_pkgcache(localdb); i; i = alpm_list_next(i)) {
+        alpm_pkg_t *pkg = (alpm_pkg_t *)i->data;
+        LocalPkg &local = pkgs[alpm_pkg_get_name(pkg)];
+        local.version = alpm_pkg_get_version(pkg);
+        local.reason = (alpm_pkg_get_reason(pkg) == ALPM_PKG_REASON_DEPEND) ?
+                       IRE_ASDEPS : IRE_EXPLICIT;
+    }
+}
@@ -0,0 +1,63 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef LOCALINDEX_H
+#define LOCALINDEX_H
+
+#include <alpm.h>
+#include <string>
+#include <unordered_map>
+
+#include "package.h"
+
+struct LocalPkg {
+    std::string version;
+    InstallReasonEnum reason;
+};
+
+/* Version and install reason of every installed package, read from the
+   local db in a single pass. Lookups do not touch libalpm and may run
+   concurrently. */
+class LocalIndex
+{
+public:
+    /* Reads localdb. This also forces libalpm to read the details of all
+       local packages, which it otherwise does lazily and not thread safe. */
+    void build(alpm_db_t *localdb);
+
+    void clear()
+    {
+        pkgs.clear();
+    }
+
+    bool empty() const
+    {
+        return pkgs.empty();
+    }
+
+    /* Returns NULL if name is not installed. */
+    const LocalPkg *find(const std::string &name) const
+    {
+        auto it = pkgs.find(name);
+        return (it == pkgs.end()) ? NULL : &it->second;
+    }
+
+private:
+    std::unordered_map<std::string, LocalPkg> pkgs;
+};
+
+#endif // LOCALINDEX_H
@@ -0,0 +1,109 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef LRUCACHE_H
+#define LRUCACHE_H
+
+#include <list>
+#include <map>
+#include <utility>
+
+/* Maps keys to values, holding at most capacity entries. Once full, the
+   least recently used entry is dropped to make room for a new one. */
+template <typename Key, typename Value>
+class LruCache
+{
+public:
+    explicit LruCache(size_t capacity)
+        : cap(capacity)
+    {
+    }
+
+    size_t size() const
+    {
+        return index.size();
+    }
+
+    size_t capacity() const
+    {
+        return cap;
+    }
+
+    /* Drops least recently used entries until at most n are left. A
+       capacity of 0 disables the cache. */
+    void setcapacity(size_t n)
+    {
+        cap = n;
+        shrink(cap);
+    }
+
+    /* Returns the value of key and marks it as recently used, NULL if it
+       is not cached. The pointer stays valid until the next insert(). */
+    const Value *find(const Key &key)
+    {
+        typename Index::iterator it = index.find(key);
+        if (it == index.end()) {
+            return NULL;
+        }
+
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->second;
+    }
+
+    void insert(const Key &key, Value value)
+    {
+        if (cap == 0) {
+            return;
+        }
+
+        typename Index::iterator it = index.find(key);
+        if (it != index.end()) {
+            it->second->second = std::move(value);
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+
+        shrink(cap - 1);
+        entries.push_front(std::make_pair(key, std::move(value)));
+        index[key] = entries.begin();
+    }
+
+    void clear()
+    {
+        entries.clear();
+        index.clear();
+    }
+
+private:
+    typedef std::list<std::pair<Key, Value> > List;
+    typedef std::map<Key, typename List::iterator> Index;
+
+    void shrink(size_t n)
+    {
+        while (index.size() > n) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+    /* most recently used first */
+    List entries;
+    Index index;
+    size_t cap;
+};
+
+#endif // LRUCACHE_H
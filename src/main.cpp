@@ -15,25 +15,35 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
  ************************************************************************* */
 
+#include <fstream>
+#include <getopt.h>
 #include <iostream>
 #include <unistd.h>
 
 #include "globals.h"
 #include "pcursesexception.h"
+#include "profiler.h"
 #include "program.h"
+#include "stringpool.h"
 
 static char *opt_conf_file = nullptr;
+static bool opt_stats = false;
+static bool opt_profile = false;
+static const char *opt_profile_file = nullptr;
 
 static void usage()
 {
     fprintf(stderr,
-            "Usage: %s [-h] [-v] [-f CONF_FILE]\n"
+            "Usage: %s [-h] [-v] [-s] [-f CONF_FILE] [--profile[=FILE]]\n"
             "\n"
             "Arguments:\n"
             "----------\n"
             "-h:            print this message\n"
             "-v:            print version info\n"
+            "-s:            print memory statistics on exit\n"
             "-f:            specify an alternate config file location\n"
+            "--profile:     print timings of startup phases and commands on exit,\n"
+            "               or write them to FILE\n"
             "\n"
             "Detailed help can be found the README and CONCEPT files located at\n"
             "https://github.com/schuay/pcurses\n"
@@ -66,11 +76,12 @@ static void usage()
             "Filter, search, sort, and colorcode operations all use slight variations of the\n"
             "same syntax:\n"
             "\n"
-            "<operator>[[<field list>][!]:]<regex>\n"
+            "<operator>[[<field list>][!]{:|=}]<regex>\n"
             "\n"
             "where <operator> is the appropriate operator char (/ for filter),\n"
             "<field list> is an optional list of fields to search (n for package name)\n"
             "! negates the query and filters all non-matching packages\n"
+            "= instead of : keeps only fields equal to the whole phrase\n"
             "and regex specifies the search terms.\n"
             "\n"
             "Examples:\n"
@@ -92,11 +103,23 @@ static void parseargs(int argc, char *argv[])
 {
     int opt;
 
-    while ((opt = getopt(argc, argv, "hvf:")) != -1) {
+    static const struct option longopts[] = {
+        { "profile", optional_argument, NULL, 'p' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    while ((opt = getopt_long(argc, argv, "hvsf:", longopts, NULL)) != -1) {
         switch (opt) {
+        case 'p':
+            opt_profile = true;
+            opt_profile_file = optarg;
+            break;
         case 'f':
             opt_conf_file = optarg;
             break;
+        case 's':
+            opt_stats = true;
+            break;
         case 'v':
             fprintf(stdout, "%s %d\n", APPLICATION_NAME, VERSION);
             exit(EXIT_SUCCESS);
@@ -112,14 +135,23 @@ static void parseargs(int argc, char *argv[])
 int main(int argc, char *argv[])
 {
     std::string err;
+    size_t internedstrings = 0, internedsaved = 0;
 
     parseargs(argc, argv);
 
+    if (opt_profile) {
+        Profiler::profiler().enable();
+    }
+
     Program *p = new Program();
 
     try {
         p->init(opt_conf_file);
         p->mainloop();
+
+        /* the pool is emptied when the program shuts down */
+        internedstrings = StringPool::pool().size();
+        internedsaved = StringPool::pool().bytessaved();
     } catch (PcursesException e) {
         err = e.getmessage();
     } catch (...) {
@@ -135,5 +167,17 @@ int main(int argc, char *argv[])
 
     }
 
+    if (opt_profile && opt_profile_file != nullptr) {
+        std::ofstream out(opt_profile_file);
+        Profiler::profiler().report(out);
+    } else if (opt_profile) {
+        Profiler::profiler().report(std::cerr);
+    }
+
+    if (opt_stats) {
+        std::cerr << "interned strings: " << internedstrings
+                  << " (" << internedsaved << " bytes saved)" << std::endl;
+    }
+
     return 0;
 }
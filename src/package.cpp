@@ -17,85 +17,109 @@
 
 #include "package.h"
 
-#include <boost/xpressive/xpressive.hpp>
-#include <boost/algorithm/string.hpp>
-#include <ctime>
-#include <sstream>
-
-#include "pcursesexception.h"
+#include "record.h"
+#include "stringpool.h"
 
 using std::string;
-using std::vector;
-using boost::xpressive::regex_constants::icase;
-using boost::xpressive::sregex;
-using boost::xpressive::smatch;
 
-Package::Package(alpm_pkg_t *pkg, alpm_db_t *localdb)
+static const string *intern(const string &str)
 {
-    alpm_pkg_t *_pkg = pkg;
-    alpm_pkg_t *_localpkg = alpm_db_get_pkg(localdb, alpm_pkg_get_name(_pkg));
-
-    _name = trimstr(alpm_pkg_get_name(_pkg));
-    _url = trimstr(alpm_pkg_get_url(_pkg));
-    _packager = trimstr(alpm_pkg_get_packager(_pkg));
-    _desc = trimstr(alpm_pkg_get_desc(_pkg));
-    _version = trimstr(alpm_pkg_get_version(_pkg));
-    _dbname = trimstr(alpm_db_get_name(alpm_pkg_get_db(_pkg)));
-    _builddate = alpm_pkg_get_builddate(_pkg);
-    _arch = trimstr(alpm_pkg_get_arch(_pkg));
-
-    _size = alpm_pkg_get_size(_pkg);
-    _installsize = alpm_pkg_get_isize(_pkg);
-
-    _sizestr = size2str(_size);
-    _installsizestr = size2str(_installsize);
-
-    _licenses = list2str(alpm_pkg_get_licenses(_pkg), " ");
-    _groups = list2str(alpm_pkg_get_groups(_pkg), " ");
-
-    _optdepends = deplist2str(alpm_pkg_get_optdepends(_pkg),
-                              "\n            "); /* line up correctly in info pane */
-    _conflicts = deplist2str(alpm_pkg_get_conflicts(_pkg), " ");
-    _provides = deplist2str(alpm_pkg_get_provides(_pkg), " ");
-    _replaces = deplist2str(alpm_pkg_get_replaces(_pkg), " ");
-    _depends = deplist2str(alpm_pkg_get_depends(_pkg), " ");
-
-    _signature = alpm_pkg_get_base64_sig(_pkg) ? "Yes" : "None";
-
-    if (_localpkg == NULL) {
-        _updatestate = USE_NOTINSTALLED;
-    } else {
-        _localversion = alpm_pkg_get_version(_localpkg);
-        _updatestate = (alpm_pkg_vercmp(_version.c_str(), _localversion.c_str()) > 0) ?
-                       USE_UPDATEAVAILABLE : USE_UPTODATE;
+    return StringPool::pool().intern(str);
+}
+
+Package::Package()
+    : _pkg(NULL), _record(NULL), _recordend(NULL)
+{
+}
+
+Package::Package(alpm_pkg_t *pkg)
+    : _pkg(pkg), _record(NULL), _recordend(NULL)
+{
+}
+
+Package::Package(const char *&pos, const char *end)
+    : _pkg(NULL)
+{
+    const uint32_t len = getnum<uint32_t>(pos, end);
+    if ((size_t)(end - pos) < len) {
+        throw PcursesException("Truncated snapshot record.");
     }
+    _record = pos;
+    _recordend = pos + len;
+    pos = _recordend;
+}
+
+void Package::serialize(string &buf) const
+{
+    /* do not keep details around just because they were written */
+    std::unique_ptr<Details> tmp(_details ? NULL : readdetails());
+    const Details &d = _details ? *_details : *tmp;
 
-    _reason = ((_localpkg == NULL) ? IRE_NOTINSTALLED :
-               (alpm_pkg_get_reason(_localpkg) == ALPM_PKG_REASON_DEPEND) ? IRE_ASDEPS :
-               IRE_EXPLICIT);
+    string section;
+    putstr(section, *d.url);
+    putstr(section, *d.packager);
+    putstr(section, *d.arch);
+    putstr(section, *d.licenses);
+    putstr(section, *d.groups);
+    putstr(section, d.depends);
+    putstr(section, d.optdepends);
+    putstr(section, d.conflicts);
+    putstr(section, d.provides);
+    putstr(section, d.replaces);
+    putstr(section, *d.signature);
+
+    putstr(buf, section);
 }
 
-string Package::size2str(off_t size)
+const Package::Details &Package::details() const
 {
-    std::stringstream ss;
+    if (!_details) {
+        _details.reset(readdetails());
+    }
 
-    float fsize = size;
+    return *_details;
+}
 
-    int currentunit =  0;
-    string units[] = {"B", "KB", "MB", "GB", "TB"};
-    int unitssize = sizeof(units) / sizeof(units[0]);
+Package::Details *Package::readdetails() const
+{
+    Details *d = new Details;
 
-    while (fsize > 1024.0 && currentunit < unitssize - 1) {
-        fsize /= 1024.0;
-        currentunit++;
+    if (_pkg == NULL) {
+        const char *pos = _record;
+        d->url = intern(getstr(pos, _recordend));
+        d->packager = intern(getstr(pos, _recordend));
+        d->arch = intern(getstr(pos, _recordend));
+        d->licenses = intern(getstr(pos, _recordend));
+        d->groups = intern(getstr(pos, _recordend));
+        d->depends = getstr(pos, _recordend);
+        d->optdepends = getstr(pos, _recordend);
+        d->conflicts = getstr(pos, _recordend);
+        d->provides = getstr(pos, _recordend);
+        d->replaces = getstr(pos, _recordend);
+        d->signature = intern(getstr(pos, _recordend));
+        return d;
     }
 
-    ss << std::fixed << std::setprecision(2) << fsize << " " << units[currentunit];
+    d->url = intern(trimstr(alpm_pkg_get_url(_pkg)));
+    d->packager = intern(trimstr(alpm_pkg_get_packager(_pkg)));
+    d->arch = intern(trimstr(alpm_pkg_get_arch(_pkg)));
 
-    return ss.str();
+    d->licenses = intern(list2str(alpm_pkg_get_licenses(_pkg), " "));
+    d->groups = intern(list2str(alpm_pkg_get_groups(_pkg), " "));
+
+    d->optdepends = deplist2str(alpm_pkg_get_optdepends(_pkg),
+                                "\n            "); /* line up correctly in info pane */
+    d->conflicts = deplist2str(alpm_pkg_get_conflicts(_pkg), " ");
+    d->provides = deplist2str(alpm_pkg_get_provides(_pkg), " ");
+    d->replaces = deplist2str(alpm_pkg_get_replaces(_pkg), " ");
+    d->depends = deplist2str(alpm_pkg_get_depends(_pkg), " ");
+
+    d->signature = intern(alpm_pkg_get_base64_sig(_pkg) ? "Yes" : "None");
+
+    return d;
 }
 
-string Package::trimstr(const char *c) const
+string Package::trimstr(const char *c)
 {
     if (c == NULL) {
         return "";
@@ -117,7 +141,7 @@ string Package::trimstr(const char *c) const
 
 
 
-string Package::deplist2str(alpm_list_t *l, string delim) const
+string Package::deplist2str(alpm_list_t *l, string delim)
 {
     string res = "";
     for (alpm_list_t *deps = l; deps != NULL; deps = alpm_list_next(deps)) {
@@ -130,7 +154,7 @@ string Package::deplist2str(alpm_list_t *l, string delim) const
     return res;
 }
 
-string Package::list2str(alpm_list_t *l, string delim) const
+string Package::list2str(alpm_list_t *l, string delim)
 {
     string s, res = "";
     for (alpm_list_t *i = l; i != NULL; i = alpm_list_next(i)) {
@@ -143,208 +167,57 @@ string Package::list2str(alpm_list_t *l, string delim) const
     return res;
 }
 
-string Package::getattr(AttributeEnum attr) const
-{
-    switch (attr) {
-    case A_NAME:
-        return getname();
-    case A_VERSION:
-        return getversion();
-    case A_URL:
-        return geturl();
-    case A_REPO:
-        return getrepo();
-    case A_PACKAGER:
-        return getpackager();
-    case A_BUILDDATE:
-        return getbuilddate();
-    case A_INSTALLSTATE:
-        return getreason();
-    case A_UPDATESTATE:
-        return getupdatestate();
-    case A_DESC:
-        return getdesc();
-    case A_ARCH:
-        return getarch();
-    case A_LICENSES:
-        return getlicenses();
-    case A_GROUPS:
-        return getgroups();
-    case A_DEPENDS:
-        return getdepends();
-    case A_OPTDEPENDS:
-        return getoptdepends();
-    case A_CONFLICTS:
-        return getconflicts();
-    case A_PROVIDES:
-        return getprovides();
-    case A_REPLACES:
-        return getreplaces();
-    case A_SIGNATURE:
-        return getsignature();
-    case A_SIZE:
-        return getsize();
-    case A_ISIZE:
-        return getisize();
-    case A_NONE:
-        return "";
-    default:
-        throw PcursesException("Invalid attribute passed.");
-    }
-}
-
-off_t Package::getoffattr(AttributeEnum attr) const
-{
-    switch (attr) {
-    case A_BUILDDATE:
-        return (off_t)_builddate;
-    case A_SIZE:
-        return _size;
-    case A_ISIZE:
-        return _installsize;
-    default:
-        throw PcursesException("Invalid attribute passed.");
-    }
-}
-
-void Package::setcolindex(int index)
-{
-    _colindex = index;
-}
-
-int Package::getcolindex() const
-{
-    return _colindex;
-}
-
-string Package::getname() const
+const string &Package::getpackager() const
 {
-    return _name;
+    return *details().packager;
 }
 
-string Package::getdesc() const
+const string &Package::geturl() const
 {
-    return _desc;
+    return *details().url;
 }
 
-string Package::getversion() const
+const string &Package::getarch() const
 {
-    if (_updatestate == USE_UPDATEAVAILABLE) {
-        return _version + " (local: " + _localversion + ")";
-    }
-    return _version;
-}
-
-string Package::getrepo() const
-{
-    return _dbname;
-}
-
-string Package::getreason() const
-{
-    switch (_reason) {
-    case IRE_NOTINSTALLED:
-        return "not installed";
-    case IRE_EXPLICIT:
-        return "explicit";
-    case IRE_ASDEPS:
-        return "as dependency";
-    default:
-        throw PcursesException("no package install reason.");
-    }
-}
-
-string Package::getpackager() const
-{
-    return _packager;
-}
-
-string Package::geturl() const
-{
-    return _url;
-}
-
-string Package::getbuilddate() const
-{
-    string timestr = std::ctime(&_builddate);
-    return timestr.substr(0, timestr.length() - 1); //remove newline
-}
-
-string Package::getarch() const
-{
-    return _arch;
-}
-
-string Package::getlicenses() const
-{
-    return _licenses;
-}
-
-string Package::getgroups() const
-{
-    return _groups;
-}
-
-string Package::getdepends() const
-{
-    return _depends;
-}
-
-string Package::getoptdepends() const
-{
-    return _optdepends;
+    return *details().arch;
 }
 
-string Package::getconflicts() const
+const string &Package::getlicenses() const
 {
-    return _conflicts;
+    return *details().licenses;
 }
 
-string Package::getprovides() const
+const string &Package::getgroups() const
 {
-    return _provides;
+    return *details().groups;
 }
 
-string Package::getreplaces() const
+const string &Package::getdepends() const
 {
-    return _replaces;
+    return details().depends;
 }
 
-string Package::getsignature() const
+const string &Package::getoptdepends() const
 {
-    return _signature;
+    return details().optdepends;
 }
 
-string Package::getsize() const
+const string &Package::getconflicts() const
 {
-    return _sizestr;
+    return details().conflicts;
 }
 
-string Package::getisize() const
+const string &Package::getprovides() const
 {
-    return _installsizestr;
-}
-
-string Package::getupdatestate() const
-{
-    switch (_updatestate) {
-    case USE_NOTINSTALLED:
-        return "not installed";
-    case USE_UPDATEAVAILABLE:
-        return "update available";
-    case USE_UPTODATE:
-        return "up to date";
-    default:
-        throw PcursesException("no package update state.");
-    }
+    return details().provides;
 }
 
-void Package::setop(OperationEnum oe)
+const string &Package::getreplaces() const
 {
-    op = oe;
+    return details().replaces;
 }
 
-OperationEnum Package::getop() const
+const string &Package::getsignature() const
 {
-    return op;
+    return *details().signature;
 }
@@ -19,20 +19,19 @@
 #define PACKAGE_H
 
 #include <alpm.h>
+#include <cstdint>
+#include <memory>
 #include <string>
-#include <vector>
-
-#include "attributeinfo.h"
 
 typedef struct __alpm_pkg_t alpm_pkg_t;
 
-enum InstallReasonEnum {
+enum InstallReasonEnum : uint8_t {
     IRE_EXPLICIT,
     IRE_ASDEPS,
     IRE_NOTINSTALLED
 };
 
-enum UpdateStateEnum {
+enum UpdateStateEnum : uint8_t {
     USE_NOTINSTALLED,
     USE_UPTODATE,
     USE_UPDATEAVAILABLE
@@ -46,79 +45,71 @@ enum OperationEnum {
 };
 
 
+/* The rarely needed fields of a package (usually only shown in the info
+   pane). Everything needed to scan the package list lives in the columns
+   of the PackageStore. A Package only keeps a handle to the data it was
+   loaded from and reads the actual values the first time one of them is
+   requested. */
 class Package
 {
 public:
-    Package(alpm_pkg_t *pkg, alpm_db_t *localdb);
-
-    std::string getarch() const;
-    std::string getbuilddate() const;
-    std::string getconflicts() const;
-    std::string getdepends() const;
-    std::string getdesc() const;
-    std::string getgroups() const;
-    std::string getisize() const;
-    std::string getlicenses() const;
-    std::string getname() const;
-    std::string getoptdepends() const;
-    std::string getpackager() const;
-    std::string getprovides() const;
-    std::string getreason() const;
-    std::string getreplaces() const;
-    std::string getrepo() const;
-    std::string getsignature() const;
-    std::string getsize() const;
-    std::string getupdatestate() const;
-    std::string geturl() const;
-    std::string getversion() const;
-
-    std::string getattr(AttributeEnum attr) const;
-    off_t getoffattr(AttributeEnum attr) const;
-
-    void setcolindex(int index);
-    int getcolindex() const;
-
-    void setop(OperationEnum oe);
-    OperationEnum getop() const;
+    Package();
+
+    /* The alpm handle pkg belongs to must outlive the package. */
+    explicit Package(alpm_pkg_t *pkg);
+
+    /* Reads a details section written by serialize() and advances pos past
+       it. The section must stay mapped for the lifetime of the package.
+       Throws if the section does not fit between pos and end. */
+    Package(const char *&pos, const char *end);
+
+    /* Appends a details section to buf. */
+    void serialize(std::string &buf) const;
+
+    const std::string &getarch() const;
+    const std::string &getconflicts() const;
+    const std::string &getdepends() const;
+    const std::string &getgroups() const;
+    const std::string &getlicenses() const;
+    const std::string &getoptdepends() const;
+    const std::string &getpackager() const;
+    const std::string &getprovides() const;
+    const std::string &getreplaces() const;
+    const std::string &getsignature() const;
+    const std::string &geturl() const;
+
+    static std::string trimstr(const char *c);
 
 private:
 
-    std::string trimstr(const char *c) const;
-    std::string deplist2str(alpm_list_t *l, std::string delim) const;
-    std::string list2str(alpm_list_t *l, std::string delim) const;
-    static std::string size2str(off_t size);
-
-    std::string _name,
-        _url,
-        _packager,
-        _desc,
-        _version,
-        _dbname,
-        _arch,
-        _licenses,
-        _groups,
-        _depends,
-        _optdepends,
-        _conflicts,
-        _provides,
-        _replaces,
-        _sizestr,
-        _signature,
-        _installsizestr,
-        _localversion;
-
-    int _colindex;
-
-    off_t _size,
-          _installsize;
-
-    time_t _builddate;
-
-    UpdateStateEnum _updatestate;
-
-    InstallReasonEnum _reason;
-
-    OperationEnum op;
+    /* Values shared by many packages are interned in the StringPool. */
+    struct Details {
+        const std::string *url,
+              *packager,
+              *arch,
+              *licenses,
+              *groups,
+              *signature;
+        std::string depends,
+            optdepends,
+            conflicts,
+            provides,
+            replaces;
+    };
+
+    const Details &details() const;
+    Details *readdetails() const;
+
+    static std::string deplist2str(alpm_list_t *l, std::string delim);
+    static std::string list2str(alpm_list_t *l, std::string delim);
+
+    /* where details are read from: either a libalpm package, or the
+       details section of a snapshot record */
+    alpm_pkg_t *_pkg;
+    const char *_record,
+          *_recordend;
+
+    mutable std::unique_ptr<Details> _details;
 };
 
 #endif // PACKAGE_H
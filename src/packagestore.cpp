@@ -0,0 +1,524 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "packagestore.h"
+
+#include <algorithm>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <ctime>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <sstream>
+
+#include "parallel.h"
+#include "pcursesexception.h"
+#include "record.h"
+#include "stringpool.h"
+
+using std::string;
+
+void PackageStore::clear()
+{
+    names.clear();
+    descs.clear();
+    versions.clear();
+    localversions.clear();
+    repoids.clear();
+    repos.clear();
+    sizes.clear();
+    installsizes.clear();
+    builddates.clear();
+    reasons.clear();
+    updatestates.clear();
+    colindices.clear();
+    records.clear();
+
+    clearcaches();
+}
+
+void PackageStore::clearcaches()
+{
+    versionstrs.clear();
+    builddatestrs.clear();
+    sizestrs.clear();
+    isizestrs.clear();
+
+    for (std::vector<string> &column : folded) {
+        column.clear();
+    }
+    for (TrigramIndex &index : trigrams) {
+        index.clear();
+    }
+    for (FacetIndex &index : facets) {
+        index.clear();
+    }
+    for (std::vector<PkgId> &order : sorted) {
+        order.clear();
+    }
+    for (std::vector<uint32_t> &rank : ranks) {
+        rank.clear();
+    }
+}
+
+RepoId PackageStore::addrepo(const string &name)
+{
+    /* there are only a few repos, only new ones go to the pool */
+    for (RepoId i = 0; i < repos.size(); i++) {
+        if (*repos[i] == name) {
+            return i;
+        }
+    }
+
+    repos.push_back(StringPool::pool().intern(name));
+    return repos.size() - 1;
+}
+
+void PackageStore::resize(PkgId n)
+{
+    names.resize(n);
+    descs.resize(n);
+    versions.resize(n);
+    localversions.resize(n);
+    repoids.resize(n);
+    sizes.resize(n);
+    installsizes.resize(n);
+    builddates.resize(n);
+    reasons.resize(n);
+    updatestates.resize(n);
+    colindices.resize(n);
+    records.resize(n);
+
+    clearcaches();
+    folded[A_NAME].resize(n);
+    folded[A_DESC].resize(n);
+}
+
+void PackageStore::set(PkgId id, alpm_pkg_t *pkg, RepoId repo)
+{
+    names[id] = Package::trimstr(alpm_pkg_get_name(pkg));
+    descs[id] = Package::trimstr(alpm_pkg_get_desc(pkg));
+    folded[A_NAME][id] = boost::to_lower_copy(names[id]);
+    folded[A_DESC][id] = boost::to_lower_copy(descs[id]);
+    versions[id] = Package::trimstr(alpm_pkg_get_version(pkg));
+    repoids[id] = repo;
+    builddates[id] = alpm_pkg_get_builddate(pkg);
+    sizes[id] = alpm_pkg_get_size(pkg);
+    installsizes[id] = alpm_pkg_get_isize(pkg);
+    colindices[id] = 0;
+    localversions[id].clear();
+    reasons[id] = IRE_NOTINSTALLED;
+    updatestates[id] = USE_NOTINSTALLED;
+    records[id] = Package(pkg);
+}
+
+void PackageStore::take(PkgId id, PackageStore &from, PkgId fromid,
+                        std::vector<RepoId> &repomap)
+{
+    const RepoId repo = from.repoids[fromid];
+    if (repomap.size() < from.repos.size()) {
+        repomap.resize(from.repos.size(), std::numeric_limits<RepoId>::max());
+    }
+    if (repomap[repo] == std::numeric_limits<RepoId>::max()) {
+        repomap[repo] = addrepo(*from.repos[repo]);
+    }
+
+    names[id] = from.names[fromid];
+    descs[id] = std::move(from.descs[fromid]);
+    folded[A_NAME][id] = std::move(from.folded[A_NAME][fromid]);
+    folded[A_DESC][id] = std::move(from.folded[A_DESC][fromid]);
+    versions[id] = std::move(from.versions[fromid]);
+    localversions[id] = std::move(from.localversions[fromid]);
+    repoids[id] = repomap[repo];
+    builddates[id] = from.builddates[fromid];
+    sizes[id] = from.sizes[fromid];
+    installsizes[id] = from.installsizes[fromid];
+    reasons[id] = from.reasons[fromid];
+    updatestates[id] = from.updatestates[fromid];
+    colindices[id] = from.colindices[fromid];
+    records[id] = std::move(from.records[fromid]);
+}
+
+void PackageStore::setlocal(const LocalIndex &index)
+{
+    versionstrs.clear();
+    for (AttributeEnum attr : { A_VERSION, A_INSTALLSTATE, A_UPDATESTATE }) {
+        folded[attr].clear();
+        trigrams[attr].clear();
+        facets[attr].clear();
+        sorted[attr].clear();
+        ranks[attr].clear();
+    }
+
+    /* names are unique within the store, so each one is looked up once */
+    parallel_for(size(), 1024, [this, &index] (size_t begin, size_t end) {
+        for (size_t id = begin; id < end; id++) {
+            const LocalPkg *local = index.find(names[id]);
+
+            if (local == NULL) {
+                localversions[id].clear();
+                reasons[id] = IRE_NOTINSTALLED;
+                updatestates[id] = USE_NOTINSTALLED;
+                continue;
+            }
+
+            localversions[id] = local->version;
+            reasons[id] = local->reason;
+            updatestates[id] = (alpm_pkg_vercmp(versions[id].c_str(),
+                                                local->version.c_str()) > 0) ?
+                               USE_UPDATEAVAILABLE : USE_UPTODATE;
+        }
+    });
+}
+
+bool PackageStore::find(const string &name, PkgId &id) const
+{
+    auto it = std::lower_bound(names.begin(), names.end(), name);
+    if (it == names.end() || *it != name) {
+        return false;
+    }
+
+    id = it - names.begin();
+    return true;
+}
+
+void PackageStore::serialize(PkgId id, string &buf) const
+{
+    putstr(buf, names[id]);
+    putstr(buf, descs[id]);
+    putstr(buf, versions[id]);
+    putstr(buf, getrepo(id));
+    putstr(buf, localversions[id]);
+    putnum<int64_t>(buf, builddates[id]);
+    putnum<int64_t>(buf, sizes[id]);
+    putnum<int64_t>(buf, installsizes[id]);
+    putnum<uint8_t>(buf, updatestates[id]);
+    putnum<uint8_t>(buf, reasons[id]);
+
+    records[id].serialize(buf);
+}
+
+void PackageStore::deserialize(PkgId id, const char *&pos, const char *end)
+{
+    names[id] = getstr(pos, end);
+    descs[id] = getstr(pos, end);
+    folded[A_NAME][id] = boost::to_lower_copy(names[id]);
+    folded[A_DESC][id] = boost::to_lower_copy(descs[id]);
+    versions[id] = getstr(pos, end);
+    repoids[id] = addrepo(getstr(pos, end));
+    localversions[id] = getstr(pos, end);
+    builddates[id] = getnum<int64_t>(pos, end);
+    sizes[id] = getnum<int64_t>(pos, end);
+    installsizes[id] = getnum<int64_t>(pos, end);
+    updatestates[id] = (UpdateStateEnum)getnum<uint8_t>(pos, end);
+    reasons[id] = (InstallReasonEnum)getnum<uint8_t>(pos, end);
+    colindices[id] = 0;
+
+    records[id] = Package(pos, end);
+}
+
+void PackageStore::fold(AttributeEnum attr) const
+{
+    std::vector<string> &column = folded[attr];
+
+    column.resize(names.size());
+    for (PkgId id = 0; id < names.size(); id++) {
+        column[id] = boost::to_lower_copy(getattr(id, attr));
+    }
+}
+
+void PackageStore::prepare(AttributeEnum attr, bool folded) const
+{
+    if (folded) {
+        if (this->folded[attr].size() != names.size()) {
+            fold(attr);
+        }
+        return;
+    }
+
+    /* fold() goes through getattr() as well */
+    for (PkgId id = 0; id < names.size(); id++) {
+        getattr(id, attr);
+    }
+}
+
+const TrigramIndex &PackageStore::gettrigrams(AttributeEnum attr) const
+{
+    if (!trigrams[attr].isbuilt()) {
+        if (folded[attr].size() != names.size()) {
+            fold(attr);
+        }
+        trigrams[attr].build(folded[attr]);
+    }
+
+    return trigrams[attr];
+}
+
+bool PackageStore::isnumeric(AttributeEnum attr)
+{
+    return attr == A_SIZE || attr == A_ISIZE || attr == A_BUILDDATE;
+}
+
+const std::vector<PkgId> &PackageStore::getsorted(AttributeEnum attr) const
+{
+    std::vector<PkgId> &order = sorted[attr];
+
+    if (order.size() != names.size()) {
+        order.resize(names.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [this, attr] (PkgId lhs, PkgId rhs) {
+            return less(lhs, rhs, attr);
+        });
+    }
+
+    return order;
+}
+
+const std::vector<uint32_t> &PackageStore::getranks(AttributeEnum attr) const
+{
+    std::vector<uint32_t> &rank = ranks[attr];
+
+    if (rank.size() != names.size()) {
+        const std::vector<PkgId> &order = getsorted(attr);
+
+        rank.resize(names.size());
+        uint32_t r = 0;
+        for (PkgId i = 0; i < order.size(); i++) {
+            if (i > 0 && less(order[i - 1], order[i], attr)) {
+                r++;
+            }
+            rank[order[i]] = r;
+        }
+    }
+
+    return rank;
+}
+
+bool PackageStore::less(PkgId lhs, PkgId rhs, AttributeEnum attr) const
+{
+    if (isnumeric(attr)) {
+        return getoffattr(lhs, attr) < getoffattr(rhs, attr);
+    }
+
+    return getattr(lhs, attr) < getattr(rhs, attr);
+}
+
+bool PackageStore::isfacet(AttributeEnum attr)
+{
+    switch (attr) {
+    case A_REPO:
+    case A_INSTALLSTATE:
+    case A_UPDATESTATE:
+    case A_ARCH:
+    case A_SIGNATURE:
+    case A_GROUPS:
+    case A_LICENSES:
+        return true;
+    default:
+        return false;
+    }
+}
+
+const FacetIndex &PackageStore::getfacets(AttributeEnum attr) const
+{
+    if (!facets[attr].isbuilt()) {
+        std::vector<const string *> column(names.size());
+        for (PkgId id = 0; id < names.size(); id++) {
+            column[id] = &getattr(id, attr);
+        }
+
+        /* groups and licenses are lists, see Package */
+        facets[attr].build(column, attr == A_GROUPS || attr == A_LICENSES);
+    }
+
+    return facets[attr];
+}
+
+void PackageStore::buildindices() const
+{
+    gettrigrams(A_NAME);
+    gettrigrams(A_DESC);
+
+    /* the others need the package details */
+    getfacets(A_REPO);
+    getfacets(A_INSTALLSTATE);
+    getfacets(A_UPDATESTATE);
+}
+
+string PackageStore::size2str(off_t size)
+{
+    std::stringstream ss;
+
+    float fsize = size;
+
+    int currentunit =  0;
+    string units[] = {"B", "KB", "MB", "GB", "TB"};
+    int unitssize = sizeof(units) / sizeof(units[0]);
+
+    while (fsize > 1024.0 && currentunit < unitssize - 1) {
+        fsize /= 1024.0;
+        currentunit++;
+    }
+
+    ss << std::fixed << std::setprecision(2) << fsize << " " << units[currentunit];
+
+    return ss.str();
+}
+
+const string &PackageStore::getattr(PkgId id, AttributeEnum attr) const
+{
+    static const string empty;
+
+    switch (attr) {
+    case A_NAME:
+        return names[id];
+    case A_VERSION:
+        return getversion(id);
+    case A_URL:
+        return records[id].geturl();
+    case A_REPO:
+        return getrepo(id);
+    case A_PACKAGER:
+        return records[id].getpackager();
+    case A_BUILDDATE:
+        return getbuilddate(id);
+    case A_INSTALLSTATE:
+        return getreason(id);
+    case A_UPDATESTATE:
+        return getupdatestate(id);
+    case A_DESC:
+        return descs[id];
+    case A_ARCH:
+        return records[id].getarch();
+    case A_LICENSES:
+        return records[id].getlicenses();
+    case A_GROUPS:
+        return records[id].getgroups();
+    case A_DEPENDS:
+        return records[id].getdepends();
+    case A_OPTDEPENDS:
+        return records[id].getoptdepends();
+    case A_CONFLICTS:
+        return records[id].getconflicts();
+    case A_PROVIDES:
+        return records[id].getprovides();
+    case A_REPLACES:
+        return records[id].getreplaces();
+    case A_SIGNATURE:
+        return records[id].getsignature();
+    case A_SIZE:
+        return getsize(id, sizes, sizestrs);
+    case A_ISIZE:
+        return getsize(id, installsizes, isizestrs);
+    case A_NONE:
+        return empty;
+    default:
+        throw PcursesException("Invalid attribute passed.");
+    }
+}
+
+off_t PackageStore::getoffattr(PkgId id, AttributeEnum attr) const
+{
+    switch (attr) {
+    case A_BUILDDATE:
+        return (off_t)builddates[id];
+    case A_SIZE:
+        return sizes[id];
+    case A_ISIZE:
+        return installsizes[id];
+    default:
+        throw PcursesException("Invalid attribute passed.");
+    }
+}
+
+/* returns the cached value of id in cache, if it has been formatted yet */
+static string &cached(PkgId id, PkgId n, std::vector<string> &cache)
+{
+    if (cache.size() != n) {
+        cache.resize(n);
+    }
+    return cache[id];
+}
+
+const string &PackageStore::getversion(PkgId id) const
+{
+    if (updatestates[id] != USE_UPDATEAVAILABLE) {
+        return versions[id];
+    }
+
+    string &s = cached(id, size(), versionstrs);
+    if (s.empty()) {
+        s = versions[id] + " (local: " + localversions[id] + ")";
+    }
+    return s;
+}
+
+const string &PackageStore::getbuilddate(PkgId id) const
+{
+    string &s = cached(id, size(), builddatestrs);
+    if (s.empty()) {
+        s = std::ctime(&builddates[id]);
+        s.erase(s.length() - 1); //remove newline
+    }
+    return s;
+}
+
+const string &PackageStore::getsize(PkgId id, const std::vector<off_t> &column,
+                                    std::vector<string> &cache) const
+{
+    string &s = cached(id, size(), cache);
+    if (s.empty()) {
+        s = size2str(column[id]);
+    }
+    return s;
+}
+
+const string &PackageStore::getreason(PkgId id) const
+{
+    static const string notinstalled = "not installed",
+                        explicitly = "explicit",
+                        asdeps = "as dependency";
+
+    switch (reasons[id]) {
+    case IRE_NOTINSTALLED:
+        return notinstalled;
+    case IRE_EXPLICIT:
+        return explicitly;
+    case IRE_ASDEPS:
+        return asdeps;
+    default:
+        throw PcursesException("no package install reason.");
+    }
+}
+
+const string &PackageStore::getupdatestate(PkgId id) const
+{
+    static const string notinstalled = "not installed",
+                        updateavailable = "update available",
+                        uptodate = "up to date";
+
+    switch (updatestates[id]) {
+    case USE_NOTINSTALLED:
+        return notinstalled;
+    case USE_UPDATEAVAILABLE:
+        return updateavailable;
+    case USE_UPTODATE:
+        return uptodate;
+    default:
+        throw PcursesException("no package update state.");
+    }
+}
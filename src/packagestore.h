@@ -0,0 +1,220 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef PACKAGESTORE_H
+#define PACKAGESTORE_H
+
+#include <alpm.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "attributeinfo.h"
+#include "facetindex.h"
+#include "localindex.h"
+#include "package.h"
+#include "trigramindex.h"
+
+/* Packages are referred to by their index in the PackageStore. */
+typedef uint32_t PkgId;
+typedef uint16_t RepoId;
+
+/* Holds all packages in column form: every attribute needed to scan the
+   package list (filter, sort, colorcode and the list pane itself) is kept
+   in its own contiguous array, indexed by PkgId. Everything else is in the
+   lazily loaded Package records. Packages are ordered by name. */
+class PackageStore
+{
+public:
+    PkgId size() const
+    {
+        return names.size();
+    }
+
+    bool empty() const
+    {
+        return names.empty();
+    }
+
+    /* Deletes all packages and repos. */
+    void clear();
+
+    /* Returns the id of the repo with the given name, adding it if needed. */
+    RepoId addrepo(const std::string &name);
+
+    /* Makes room for n packages which are then filled in by set() or
+       deserialize(). set() may be called concurrently for distinct ids. */
+    void resize(PkgId n);
+    void set(PkgId id, alpm_pkg_t *pkg, RepoId repo);
+
+    /* Moves package fromid of another store into slot id. Its name is
+       copied, so it can still be looked up in the other store. repomap
+       maps the repo ids of from to the ones here and is filled in as
+       needed, keep it for all packages taken from the same store. */
+    void take(PkgId id, PackageStore &from, PkgId fromid, std::vector<RepoId> &repomap);
+
+    /* Computes install reason and update state of all packages. */
+    void setlocal(const LocalIndex &index);
+
+    /* Looks up a package by name. */
+    bool find(const std::string &name, PkgId &id) const;
+
+    /* Snapshot records of single packages, see Snapshot. deserialize()
+       throws if the record does not fit between pos and end. */
+    void serialize(PkgId id, std::string &buf) const;
+    void deserialize(PkgId id, const char *&pos, const char *end);
+
+    const std::string &getname(PkgId id) const
+    {
+        return names[id];
+    }
+
+    const std::string &getrepo(PkgId id) const
+    {
+        return *repos[repoids[id]];
+    }
+
+    InstallReasonEnum getreasonenum(PkgId id) const
+    {
+        return reasons[id];
+    }
+
+    UpdateStateEnum getupdatestateenum(PkgId id) const
+    {
+        return updatestates[id];
+    }
+
+    const Package &details(PkgId id) const
+    {
+        return records[id];
+    }
+
+    /* References stay valid until the store is modified. Formatted
+       values are cached on first use, which must not happen concurrently. */
+    const std::string &getattr(PkgId id, AttributeEnum attr) const;
+    off_t getoffattr(PkgId id, AttributeEnum attr) const;
+
+    /* Lowercase copy of an attribute for case insensitive matching. Name
+       and description are folded as packages are added, other attributes
+       for all packages on first use, which must not happen concurrently. */
+    const std::string &getfolded(PkgId id, AttributeEnum attr) const
+    {
+        if (folded[attr].size() != names.size()) {
+            fold(attr);
+        }
+        return folded[attr][id];
+    }
+
+    /* Computes everything getattr() and, if folded is set, getfolded()
+       would cache on first use for attr. Afterwards both may be called
+       concurrently for attr until the store is modified. */
+    void prepare(AttributeEnum attr, bool folded) const;
+
+    /* Trigram index over the folded attribute, built on first use like
+       the folded column itself. */
+    const TrigramIndex &gettrigrams(AttributeEnum attr) const;
+
+    /* True for the attributes with numeric values, see getoffattr(). */
+    static bool isnumeric(AttributeEnum attr);
+
+    /* Ids of all packages ordered by attr, numerically for numeric
+       attributes, ties by name. Built on first use like the trigram
+       indices. */
+    const std::vector<PkgId> &getsorted(AttributeEnum attr) const;
+
+    /* The position of each package in getsorted(attr), where packages
+       with equal values share a position. Comparing ranks compares the
+       attribute values. */
+    const std::vector<uint32_t> &getranks(AttributeEnum attr) const;
+
+    /* True for the attributes with few distinct values which are kept in
+       facet indices: repo, install and update state, arch, signature,
+       groups and licenses. */
+    static bool isfacet(AttributeEnum attr);
+
+    /* Facet index of an attribute, built on first use like the trigram
+       indices. */
+    const FacetIndex &getfacets(AttributeEnum attr) const;
+
+    /* Builds the trigram indices of the default filter attributes, name
+       and description, and the facet indices of the attributes kept in
+       columns. */
+    void buildindices() const;
+
+    void setcolindex(PkgId id, int index)
+    {
+        colindices[id] = index;
+    }
+
+    int getcolindex(PkgId id) const
+    {
+        return colindices[id];
+    }
+
+private:
+    const std::string &getversion(PkgId id) const;
+    const std::string &getbuilddate(PkgId id) const;
+    const std::string &getsize(PkgId id, const std::vector<off_t> &column,
+                               std::vector<std::string> &cache) const;
+    const std::string &getreason(PkgId id) const;
+    const std::string &getupdatestate(PkgId id) const;
+
+    static std::string size2str(off_t size);
+    void clearcaches();
+
+    void fold(AttributeEnum attr) const;
+    bool less(PkgId lhs, PkgId rhs, AttributeEnum attr) const;
+
+    std::vector<std::string> names,
+        descs,
+        versions,
+        localversions;
+
+    std::vector<RepoId> repoids;
+
+    /* interned repo names, indexed by RepoId */
+    std::vector<const std::string *> repos;
+
+    std::vector<off_t> sizes,
+        installsizes;
+
+    std::vector<time_t> builddates;
+
+    std::vector<InstallReasonEnum> reasons;
+
+    std::vector<UpdateStateEnum> updatestates;
+
+    std::vector<int> colindices;
+
+    std::vector<Package> records;
+
+    /* formatted values, see getattr(). empty until first used. */
+    mutable std::vector<std::string> versionstrs,
+            builddatestrs,
+            sizestrs,
+            isizestrs;
+
+    /* see getfolded(), indexed by attribute. empty until folded. */
+    mutable std::vector<std::string> folded[A_NONE];
+    mutable TrigramIndex trigrams[A_NONE];
+    mutable FacetIndex facets[A_NONE];
+    /* see getsorted() and getranks(), empty until first used */
+    mutable std::vector<PkgId> sorted[A_NONE];
+    mutable std::vector<uint32_t> ranks[A_NONE];
+};
+
+#endif // PACKAGESTORE_H
@@ -0,0 +1,76 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+/* Number of worker threads used for parallel sections. */
+inline unsigned int parallel_threads()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return (n == 0) ? 1 : n;
+}
+
+/* Splits [0, n) into contiguous slices of at least minslice elements and
+   calls fn(begin, end) for each slice on its own worker thread. Blocks
+   until all slices are done; the first exception thrown by a worker is
+   rethrown in the calling thread. Callers are expected to write results
+   into preallocated, per-index slots so that the outcome is deterministic. */
+template <typename Fn>
+void parallel_for(size_t n, size_t minslice, Fn fn)
+{
+    size_t nthreads = std::min<size_t>(parallel_threads(),
+                                       (n + minslice - 1) / std::max<size_t>(minslice, 1));
+
+    if (nthreads <= 1) {
+        fn((size_t)0, n);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    std::vector<std::exception_ptr> errors(nthreads);
+    const size_t slice = (n + nthreads - 1) / nthreads;
+
+    for (size_t t = 0; t < nthreads; t++) {
+        const size_t begin = t * slice;
+        const size_t end = std::min(n, begin + slice);
+        workers.push_back(std::thread([&fn, &errors, t, begin, end] () {
+            try {
+                fn(begin, end);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        }));
+    }
+
+    for (std::thread &w : workers) {
+        w.join();
+    }
+
+    for (const std::exception_ptr &e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+#endif // PARALLEL_H
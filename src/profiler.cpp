@@ -0,0 +1,92 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "profiler.h"
+
+#include <boost/format.hpp>
+
+using std::string;
+
+/* Static instance. */
+Profiler Profiler::instance;
+
+Profiler &Profiler::profiler()
+{
+    return instance;
+}
+
+Profiler::Profiler()
+    : enabled(false),
+      start(Clock::now())
+{
+}
+
+Profiler::Timer::Timer(const char *phase)
+    : phase(phase)
+{
+    if (Profiler::profiler().isenabled()) {
+        start = Clock::now();
+    }
+}
+
+Profiler::Timer::~Timer()
+{
+    if (Profiler::profiler().isenabled()) {
+        Profiler::profiler().record(phase, Clock::now() - start);
+    }
+}
+
+void Profiler::record(const string &phase, Clock::duration d)
+{
+    if (!enabled) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    for (Phase &p : phases) {
+        if (p.name == phase) {
+            p.count++;
+            p.total += d;
+            p.max = std::max(p.max, d);
+            return;
+        }
+    }
+
+    phases.push_back({ phase, 1, d, d });
+}
+
+void Profiler::mark(const string &phase)
+{
+    record(phase, Clock::now() - start);
+}
+
+void Profiler::report(std::ostream &out) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    const auto ms = [] (Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+
+    out << boost::format("%-32s %8s %12s %12s %12s\n")
+        % "phase" % "count" % "total ms" % "avg ms" % "max ms";
+    for (const Phase &p : phases) {
+        out << boost::format("%-32s %8d %12.3f %12.3f %12.3f\n")
+            % p.name % p.count % ms(p.total) % (ms(p.total) / p.count) % ms(p.max);
+    }
+}
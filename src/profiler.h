@@ -0,0 +1,86 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/* Collects wall clock timings of startup phases and user commands when
+   enabled with --profile. Phases are reported in the order they were
+   first recorded. */
+class Profiler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /* Times the scope it lives in. Does nothing if profiling is off. */
+    class Timer
+    {
+    public:
+        explicit Timer(const char *phase);
+        ~Timer();
+
+    private:
+        const char *phase;
+        Clock::time_point start;
+    };
+
+    static Profiler &profiler();
+
+    void enable()
+    {
+        enabled = true;
+    }
+
+    bool isenabled() const
+    {
+        return enabled;
+    }
+
+    /* Adds a single measurement. Safe to call from several threads. */
+    void record(const std::string &phase, Clock::duration d);
+
+    /* Records the time elapsed since the program started. */
+    void mark(const std::string &phase);
+
+    void report(std::ostream &out) const;
+
+private:
+    Profiler();
+    Profiler(const Profiler &);
+
+    struct Phase {
+        std::string name;
+        size_t count;
+        Clock::duration total,
+              max;
+    };
+
+    static Profiler instance;
+
+    bool enabled;
+    const Clock::time_point start;
+    mutable std::mutex lock;
+    std::vector<Phase> phases;
+};
+
+#endif // PROFILER_H
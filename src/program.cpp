@@ -18,23 +18,29 @@
 #include "program.h"
 
 #include <boost/algorithm/string.hpp>
+#include <cstring>
 #include <iostream>
 #include <ncurses.h>
+#include <numeric>
 #include <signal.h>
 #include <sys/wait.h>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "cursesframe.h"
 #include "curseslistbox.h"
 #include "cursesui.h"
 #include "filter.h"
-#include "package.h"
+#include "parallel.h"
 #include "pcursesexception.h"
+#include "profiler.h"
+#include "query.h"
+#include "regexcache.h"
+#include "stringpool.h"
 
 using std::string;
 using std::vector;
 using std::map;
-using boost::xpressive::regex_constants::icase;
 using boost::xpressive::smatch;
 using boost::xpressive::sregex;
 
@@ -50,8 +56,14 @@ typedef struct __alpm_list_t alpm_list_t;
 #define KEY_KONSOLEBACKSPACE (127)
 
 Program::Program()
+    : filtercache(32)
 {
     quit = false;
+    loading = false;
+    parallelthreshold = 0;
+    livecursor = 0;
+    editing = false;
+    editlink = 0;
 }
 
 Program::~Program()
@@ -63,13 +75,30 @@ void Program::deinit()
 {
     CursesUi::ui().disable_curses();
 
-    for (uint i = 0; i < packages.size(); i++) {
-        delete packages[i];
-    }
+    loader.stop();
+    loading = false;
+    state.loadprogress.clear();
 
     filteredpackages.clear();
     packages.clear();
     opqueue.clear();
+    filterstack.clear();
+    dbstamps.clear();
+    localindex.clear();
+
+    StringPool::pool().clear();
+
+    releasehandles();
+    snapshot.unload();
+}
+
+void Program::releasehandles()
+{
+    /* also called from the destructor, so errors are not reported here */
+    for (const auto &h : handles) {
+        alpm_release(h.second);
+    }
+    handles.clear();
 }
 
 void Program::run_cmd(const string &cmd) const
@@ -105,6 +134,7 @@ void Program::init_misc()
     state.searchphrases.clear();
 
     /* exec startup macro if it exists */
+    Profiler::Timer timer("startup: macro");
     execmacro("startup");
 }
 
@@ -116,11 +146,15 @@ void Program::init(const char *conf_file)
 
     loadpkgs();
 
-    CursesUi::ui().enable_curses(&filteredpackages, &opqueue);
+    CursesUi::ui().enable_curses(&packages, &filteredpackages, &opqueue);
 
     init_misc();
 
-    CursesUi::ui().update_display(state);
+    {
+        Profiler::Timer timer("startup: first render");
+        CursesUi::ui().update_display(state);
+    }
+    Profiler::profiler().mark("startup: ui ready");
 }
 
 void Program::mainloop()
@@ -129,13 +163,19 @@ void Program::mainloop()
     while (!quit) {
         ch = getch();
 
+        /* add whatever the loader has read in the meantime */
+        pollloader();
+
         /* If a resize has been requested, handle it. */
         CursesUi::ui().handle_resize(state);
 
         if (ch == ERR || ch == KEY_RESIZE) {
+            steplivefilter();
             continue;
         }
 
+        state.error.clear();
+
         if (state.mode == MODE_STANDARD) {
             switch (ch) {
             case 'k':
@@ -194,6 +234,12 @@ void Program::mainloop()
             case 'c':
                 execctrl(CTRL_FILTER_CLEAR);
                 break;
+            case 'u':
+                execctrl(CTRL_FILTER_POP);
+                break;
+            case 'e':
+                execctrl(CTRL_FILTER_EDIT);
+                break;
             case 'n':
             case 'd':
                 prepinputmode(OP_FILTER);
@@ -239,12 +285,18 @@ void Program::mainloop()
                 state.inputbuf.moveend();
                 break;
             case KEY_UP:
-                if (!gethis(state.op)->empty()) {
+                if (editing) {
+                    editlink -= (editlink > 0);
+                    state.inputbuf.set(filterstack[editlink].filter);
+                } else if (!gethis(state.op)->empty()) {
                     state.inputbuf.set(gethis(state.op)->moveback());
                 }
                 break;
             case KEY_DOWN:
-                if (!gethis(state.op)->empty()) {
+                if (editing) {
+                    editlink += (editlink + 1 < filterstack.size());
+                    state.inputbuf.set(filterstack[editlink].filter);
+                } else if (!gethis(state.op)->empty()) {
                     state.inputbuf.set(gethis(state.op)->moveforward());
                 }
                 break;
@@ -252,6 +304,10 @@ void Program::mainloop()
                 state.inputbuf.insert(ch);
                 break;
             }
+
+            if (state.mode == MODE_INPUT) {
+                live.update(state.inputbuf.getcontents());
+            }
         } else if (state.mode == MODE_HELP) {
             /* exit help screen with any key */
             state.mode = MODE_STANDARD;
@@ -268,6 +324,41 @@ void Program::prepinputmode(FilterOperationEnum o)
     state.inputbuf.clear();
     gethis(o)->reset();
     state.op = o;
+
+    if (o == OP_FILTER && !editing) {
+        livecursor = CursesUi::ui().list()->focusedindex();
+        live.start(filteredpackages);
+    }
+}
+
+void Program::steplivefilter()
+{
+    if (!live.step(packages)) {
+        /* don't wait for keys while there is work left */
+        timeout(live.running() ? 0 : 50);
+        return;
+    }
+
+    timeout(50);
+    filteredpackages = live.getresult();
+    CursesUi::ui().list()->moveabs(0);
+    CursesUi::ui().update_display(state);
+}
+
+void Program::stoplivefilter(bool apply)
+{
+    const string str = state.inputbuf.getcontents();
+
+    timeout(50);
+    filteredpackages = live.getbase();
+    CursesUi::ui().list()->moveabs(livecursor);
+
+    if (apply && str.length() != 0) {
+        filterpackages(str, live.done(str) ? &live.getresult() : nullptr);
+        flushinp();
+    }
+
+    live.stop();
 }
 
 void Program::exitinputmode(FilterOperationEnum o)
@@ -277,6 +368,21 @@ void Program::exitinputmode(FilterOperationEnum o)
 
     state.op = OP_NONE;
 
+    if (editing) {
+        editing = false;
+        /* the stack may have been rebuilt meanwhile by a reload */
+        if (o == OP_FILTER && editlink < filterstack.size()) {
+            replacefilter(editlink, state.inputbuf.getcontents());
+        }
+        return;
+    }
+
+    /* the live filter may already have the result */
+    if (live.active()) {
+        stoplivefilter(o == OP_FILTER);
+        return;
+    }
+
     if (state.inputbuf.getcontents().length() == 0) {
         return;
     }
@@ -309,78 +415,554 @@ void Program::exitinputmode(FilterOperationEnum o)
     }
 }
 
-void Program::loadpkgs()
+/* throws on malformed values before changing any */
+void Program::readoptions()
 {
-    std::cout << "Reading package dbs, please wait..." << std::endl;
+    const size_t threshold = conf.getnumoption("parallel_threshold", 4096),
+                 filters = conf.getnumoption("filter_cache_size", 32),
+                 regexes = conf.getnumoption("regex_cache_size", 64);
 
-    _alpm_errno_t err;
+    parallelthreshold = threshold;
+    filtercache.setcapacity(filters);
+    RegexCache::cache().setcapacity(regexes);
+}
 
+void Program::loadpkgs()
+{
     conf.parse_pacmanconf();
     conf.parse_pcursesconf();
     macros = conf.getmacros();
+    readoptions();
+
+    dbstamps = readdbstamps();
+
+    /* if nothing changed since the last run, skip libalpm entirely */
+    loadstamp = Snapshot::stamp(conf);
+    Profiler::Timer timer("snapshot: load");
+    if (snapshot.load(conf.getcachefile(), loadstamp, packages)) {
+        packages.buildindices();
+        resetfilteredpackages();
+        return;
+    }
+
+    /* else start with an empty list, the dbs are added as they are read */
+    loader.start(conf);
+    loading = true;
+}
+
+void Program::pollloader()
+{
+    if (!loading) {
+        return;
+    }
 
+    /* the loader is done once busy() is false, so everything it read
+       is handed over below */
+    const bool done = !loader.busy();
+    const string progress = loader.progress();
+
+    /* all dbs read since the last poll are merged first, so that the
+       list is only updated once */
+    LoadedDb db;
+    PackageStore merged;
+    bool changed = false;
+    while (loader.next(db)) {
+        mergedb(db, changed ? merged : packages, merged);
+        changed = true;
+    }
+    if (changed) {
+        replacepackages(merged);
+    }
 
-    alpm_handle_t *handle =
-        alpm_initialize(conf.getrootdir().c_str(), conf.getdbpath().c_str(), &err);
-    if (handle == NULL) {
-        throw PcursesException(alpm_strerror(err));
+    if (done) {
+        loading = false;
+        state.loadprogress.clear();
+        Profiler::profiler().mark("startup: all dbs read");
+
+        /* skipped by replacepackages() while loading */
+        packages.buildindices();
+
+        Profiler::Timer timer("snapshot: save");
+        Snapshot::save(conf.getcachefile(), loadstamp, packages);
+    } else {
+        changed |= (progress != state.loadprogress);
+        state.loadprogress = progress;
     }
 
-    alpm_option_set_logfile(handle, conf.getlogfile().c_str());
+    if (changed || done) {
+        CursesUi::ui().update_display(state);
+    }
+}
+
+void Program::mergedb(LoadedDb &db, PackageStore &from, PackageStore &into)
+{
+    Profiler::Timer timer("store: merge db");
+
+    /* packages are moved out of from, only their names stay behind */
+    handles[db.name] = db.handle;
+    db.handle = NULL;
+
+    /* dbs arrive in the order of pacman.conf after the local db, so a
+       package already in the list is only replaced if it is a local one. */
+    vector<std::pair<PackageStore *, PkgId> > picks;
+    PkgId i = 0, j = 0;
+    while (i < from.size() || j < db.store.size()) {
+        if (j == db.store.size() ||
+            (i < from.size() && from.getname(i) < db.store.getname(j))) {
+            picks.push_back(std::make_pair(&from, i++));
+        } else if (i == from.size() || db.store.getname(j) < from.getname(i)) {
+            picks.push_back(std::make_pair(&db.store, j++));
+        } else if (from.getrepo(i) == "local") {
+            picks.push_back(std::make_pair(&db.store, j++));
+            i++;
+        } else {
+            picks.push_back(std::make_pair(&from, i++));
+            j++;
+        }
+    }
 
-    vector<string> repos = conf.getrepos();
+    PackageStore fresh;
+    vector<RepoId> fromrepos, dbrepos;
+    fresh.resize(picks.size());
+    for (PkgId k = 0; k < picks.size(); k++) {
+        fresh.take(k, *picks[k].first, picks[k].second,
+                   picks[k].first == &from ? fromrepos : dbrepos);
+    }
+
+    if (db.name == "local") {
+        localindex = std::move(db.local);
+    } else {
+        fresh.setlocal(localindex);
+    }
+
+    into = std::move(fresh);
+}
+
+std::map<string, string> Program::readdbstamps() const
+{
+    map<string, string> stamps;
+
+    /* the empty key covers everything that invalidates all dbs at once */
+    string layout = conf.getrootdir() + ";" + conf.getdbpath() + ";";
+    for (const string &repo : conf.getrepos()) {
+        stamps[repo] = Snapshot::dbstamp(conf, repo);
+        layout += repo + ";";
+    }
+    stamps["local"] = Snapshot::dbstamp(conf, "local");
+    stamps[""] = layout;
+
+    return stamps;
+}
+
+void Program::updatepkgs(const std::set<string> &changed)
+{
+    const string stamp = Snapshot::stamp(conf);
+    const vector<string> repos = conf.getrepos();
+    bool syncchanged = false;
     for (const string &repo : repos) {
-        /* i'm going to be lazy here and remind myself to handle siglevel properly later on */
-        alpm_register_syncdb(handle, repo.c_str(), ALPM_SIG_USE_DEFAULT);
+        syncchanged |= (changed.count(repo) != 0);
+    }
+
+    /* changed dbs get a fresh handle, the old ones are released once no
+       package points into them anymore. if any sync db changed, all of
+       them are needed to find out which repository each package is
+       taken from. */
+    map<string, alpm_handle_t *> stale;
+    for (auto it = handles.begin(); it != handles.end();) {
+        if (changed.count(it->first) != 0 ||
+            (it->first != "local" && std::find(repos.begin(), repos.end(), it->first) == repos.end())) {
+            stale.insert(*it);
+            it = handles.erase(it);
+        } else {
+            ++it;
+        }
     }
 
-    alpm_db_t *localdb = alpm_get_localdb(handle);
+    vector<string> needed(1, "local");
+    if (syncchanged) {
+        needed.insert(needed.end(), repos.begin(), repos.end());
+    }
+    for (const string &db : needed) {
+        if (handles.count(db) == 0) {
+            handles[db] = Loader::openhandle(conf, db);
+        }
+    }
 
-    const auto cmp_pkg_name = [] (const Package *lhs, const Package *rhs) {
-        return Filter::cmp(lhs, rhs, A_NAME);
+    alpm_db_t *localdb = Loader::getdb(handles["local"], "local");
+
+    /* pick the packages to display. each name is only taken from the first
+       db it is found in, so earlier repositories win (and local only
+       packages come last). this also loads all pkgcaches, which libalpm
+       does not do in a thread safe way. packages of unchanged dbs are
+       taken over from the current store instead of being read again. */
+    struct Pick {
+        const char *name;
+        alpm_pkg_t *pkg;
+        PkgId old;
     };
 
-    /* create our package list */
-    alpm_list_t *dbs = alpm_list_copy(alpm_get_syncdbs(handle));
-    dbs = alpm_list_add(dbs, localdb);
-    for (; dbs; dbs = alpm_list_next(dbs)) {
-        alpm_db_t *db = (alpm_db_t *)dbs->data;
-        for (alpm_list_t *pkgs = alpm_db_get_pkgcache(db); pkgs; pkgs = alpm_list_next(pkgs)) {
-            alpm_pkg_t *pkg = (alpm_pkg_t *)pkgs->data;
-            Package *p = new Package(pkg, localdb);
-            Package *parray[] = { p };
-            if (!std::includes(packages.begin(), packages.end(),
-                               parray, parray + 1, cmp_pkg_name)) {
-                packages.push_back(p);
-            } else {
-                delete p;
+    PackageStore fresh;
+    std::unordered_set<string> names;
+    vector<Pick> picks;
+    vector<RepoId> pickrepos;
+
+    const auto pick = [&] (const char *name, alpm_pkg_t *pkg, const string &repo) {
+        PkgId old = 0;
+        if (names.insert(name).second) {
+            if (changed.count(repo) == 0 && packages.find(name, old) &&
+                packages.getrepo(old) == repo) {
+                pkg = NULL;
+            }
+            picks.push_back({ name, pkg, old });
+            pickrepos.push_back(fresh.addrepo(repo));
+        }
+    };
+
+    if (syncchanged) {
+        for (const string &repo : repos) {
+            alpm_db_t *db = Loader::getdb(handles[repo], repo);
+            for (alpm_list_t *j = alpm_db_get_pkgcache(db); j; j = alpm_list_next(j)) {
+                alpm_pkg_t *pkg = (alpm_pkg_t *)j->data;
+                pick(alpm_pkg_get_name(pkg), pkg, repo);
+            }
+        }
+    } else {
+        for (PkgId id = 0; id < packages.size(); id++) {
+            if (packages.getrepo(id) != "local") {
+                names.insert(packages.getname(id));
+                picks.push_back({ packages.getname(id).c_str(), NULL, id });
+                pickrepos.push_back(fresh.addrepo(packages.getrepo(id)));
+            }
+        }
+    }
+
+    for (alpm_list_t *j = alpm_db_get_pkgcache(localdb); j; j = alpm_list_next(j)) {
+        alpm_pkg_t *pkg = (alpm_pkg_t *)j->data;
+        pick(alpm_pkg_get_name(pkg), pkg, "local");
+    }
+
+    /* the store is ordered by name */
+    vector<PkgId> order(picks.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&picks] (PkgId lhs, PkgId rhs) {
+        return strcmp(picks[lhs].name, picks[rhs].name) < 0;
+    });
+
+    /* the store is filled on several threads at once, the index has
+       libalpm read all local package details beforehand */
+    if (changed.count("local") != 0 || localindex.empty()) {
+        localindex.build(localdb);
+    }
+
+    vector<RepoId> repomap;
+    fresh.resize(picks.size());
+    for (PkgId i = 0; i < picks.size(); i++) {
+        const Pick &p = picks[order[i]];
+        if (p.pkg == NULL) {
+            fresh.take(i, packages, p.old, repomap);
+        }
+    }
+
+    /* every worker fills its own slice of the store, so the result does
+       not depend on scheduling. */
+    parallel_for(picks.size(), 256, [&] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const Pick &p = picks[order[i]];
+            if (p.pkg != NULL) {
+                fresh.set(i, p.pkg, pickrepos[order[i]]);
             }
         }
-        std::sort(packages.begin(), packages.end(), cmp_pkg_name);
+    });
+    fresh.setlocal(localindex);
+
+    replacepackages(fresh);
+
+    for (const auto &h : stale) {
+        alpm_release(h.second);
+    }
+
+    Snapshot::save(conf.getcachefile(), stamp, packages);
+}
+
+void Program::reload()
+{
+    /* a reload while the dbs are still being read has nothing to add */
+    if (loading) {
+        return;
     }
-    alpm_list_free(dbs);
 
-    if (alpm_release(handle) != 0) {
-        throw PcursesException("failed to deinitialize alpm library");
+    Profiler::Timer timer("command: reload");
+
+    /* unlike at startup, errors in the config files must not end the
+       session, they are reported and the previous values kept */
+    try {
+        conf.parse_pacmanconf();
+    } catch (const PcursesException &e) {
+        state.error = e.getmessage();
+        return;
     }
+    conf.parse_pcursesconf();
+    macros = conf.getmacros();
+    try {
+        readoptions();
+    } catch (const PcursesException &e) {
+        state.error = e.getmessage();
+    }
+
+    map<string, string> stamps = readdbstamps();
 
+    /* if root, dbpath or the repositories changed, start from scratch */
+    const bool all = (stamps[""] != dbstamps[""]);
 
-    filteredpackages = packages;
+    /* install reasons and states are always read again, as they were
+       before there were stamps. mtimes may be too coarse to tell about
+       a pacman -D run in the same second, and the local db is quick to
+       read compared to the sync dbs, which are skipped if unchanged. */
+    std::set<string> changed;
+    changed.insert("local");
+    for (const auto &stamp : stamps) {
+        if (all || dbstamps[stamp.first] != stamp.second) {
+            changed.insert(stamp.first);
+        }
+    }
+
+    updatepkgs(changed);
+    dbstamps = stamps;
+}
+
+void Program::replacepackages(PackageStore &fresh)
+{
+    /* package ids change with the store, remember names instead */
+    vector<string> queued;
+    for (PkgId p : opqueue) {
+        queued.push_back(packages.getname(p));
+    }
+
+    PkgId focused;
+    string focusedname;
+    const int focusedindex = CursesUi::ui().list()->focusedindex();
+    if (CursesUi::ui().list()->focusedpackage(focused)) {
+        focusedname = packages.getname(focused);
+    }
+
+    packages = std::move(fresh);
+
+    /* while the dbs are read, the indices are built once after the last
+       one (see pollloader()), or by the first filter needing them */
+    if (!loading) {
+        packages.buildindices();
+    }
+
+    opqueue.clear();
+    for (const string &name : queued) {
+        PkgId id;
+        if (packages.find(name, id)) {
+            opqueue.push_back(id);
+        }
+    }
+    CursesUi::ui().queue()->setlist(&packages, &opqueue);
+    if (opqueue.empty()) {
+        CursesUi::ui().set_focus(PANE_LIST);
+    }
+
+    colorcodepackages(state.coloredby);
+
+    /* cached lists refer to the old ids */
+    filtercache.clear();
+
+    /* ids have changed, so does every link */
+    refilter(0);
+
+    /* a filter being typed starts over on the new list */
+    if (live.active()) {
+        live.start(filteredpackages);
+        live.update(state.inputbuf.getcontents());
+        livecursor = 0;
+    }
+
+    /* keep the cursor on the same package if it is still listed */
+    vector<PkgId>::iterator it = filteredpackages.end();
+    if (packages.find(focusedname, focused)) {
+        it = std::find(filteredpackages.begin(), filteredpackages.end(), focused);
+    }
+    CursesUi::ui().list()->moveabs(it != filteredpackages.end() ?
+                                   it - filteredpackages.begin() : focusedindex);
+}
+
+void Program::resetfilteredpackages()
+{
+    filteredpackages.resize(packages.size());
+    std::iota(filteredpackages.begin(), filteredpackages.end(), 0);
+    filterchain.clear();
 }
 
 void Program::clearfilter()
 {
-    filteredpackages = packages;
-    const AttributeEnum sortedby = state.sortedby;
-    std::sort(filteredpackages.begin(), filteredpackages.end(),
-              [sortedby] (const Package *lhs, const Package *rhs) {
-                  return Filter::cmp(lhs, rhs, sortedby);
-              });
+    filterchain = state.sortedby.str();
+    filterstack.clear();
+    listorder(filteredpackages);
 
     state.searchphrases = "";
     CursesUi::ui().list()->moveabs(0);
 }
 
+void Program::popfilter()
+{
+    if (filterstack.empty()) {
+        return;
+    }
+
+    Profiler::Timer timer("command: filter pop");
+
+    const int focusedindex = CursesUi::ui().list()->focusedindex();
+    const bool hasfocus = (size_t)focusedindex < filteredpackages.size();
+    const PkgId focused = hasfocus ? filteredpackages[focusedindex] : 0;
+
+    truncatefilters(filterstack.size() - 1);
+
+    /* keep the cursor on the same package, which is still listed */
+    vector<PkgId>::iterator it = filteredpackages.end();
+    if (hasfocus) {
+        it = std::find(filteredpackages.begin(), filteredpackages.end(), focused);
+    }
+    CursesUi::ui().list()->moveabs(it != filteredpackages.end() ?
+                                   it - filteredpackages.begin() : 0);
+}
+
+void Program::editfilter()
+{
+    if (filterstack.empty()) {
+        return;
+    }
+
+    /* starts with the last link, the live filter only works on top */
+    editing = true;
+    editlink = filterstack.size() - 1;
+    prepinputmode(OP_FILTER);
+    state.inputbuf.set(filterstack[editlink].filter);
+}
+
+void Program::replacefilter(size_t n, const string &str)
+{
+    if (str == filterstack[n].filter) {
+        return;
+    }
+
+    Profiler::Timer timer("command: filter edit");
+
+    if (str.length() != 0) {
+        gethis(OP_FILTER)->add(str);
+    }
+
+    /* an empty filter removes the link */
+    filterstack[n].filter = str;
+    refilter(n);
+}
+
+void Program::refilter(size_t from)
+{
+    vector<string> replay;
+    for (size_t i = from; i < filterstack.size(); i++) {
+        replay.push_back(filterstack[i].filter);
+    }
+
+    /* the links below from stay, the others are applied again on top */
+    truncatefilters(from);
+    for (const string &f : replay) {
+        if (f.length() != 0) {
+            applyfilter(f);
+        }
+    }
+}
+
+/* chain without its filters, the sorts in the order they were applied */
+static string dropfilters(const string &chain)
+{
+    string sorts;
+
+    size_t pos = 0;
+    while (pos < chain.length()) {
+        size_t next = chain.find('\n', pos + 1);
+        if (next == string::npos) {
+            next = chain.length();
+        }
+        if (chain.compare(pos, 2, "\n/") != 0) {
+            sorts.append(chain, pos, next - pos);
+        }
+        pos = next;
+    }
+
+    return sorts;
+}
+
+void Program::truncatefilters(size_t n)
+{
+    if (n < filterstack.size()) {
+        const size_t pos = filterstack[n].chainpos;
+        filterchain = filterchain.substr(0, pos) + dropfilters(filterchain.substr(pos));
+        filterstack.resize(n);
+    }
+
+    state.searchphrases = "";
+    for (const FilterLink &link : filterstack) {
+        if (state.searchphrases.length() != 0) {
+            state.searchphrases += ", ";
+        }
+        state.searchphrases += link.filter;
+    }
+
+    const vector<PkgId> *cached = filtercache.find(filterchain);
+    if (cached != NULL) {
+        filteredpackages = *cached;
+        return;
+    }
+
+    /* filters keep the order of the list, so the packages left by the
+       remaining links are listed as all packages would be after the sorts */
+    listorder(filteredpackages);
+    if (!filterstack.empty()) {
+        const Bitset &kept = filterstack.back().selection;
+        filteredpackages.erase(std::remove_if(filteredpackages.begin(), filteredpackages.end(),
+                                              [&kept] (PkgId a) {
+                                                  return !kept.test(a);
+                                              }),
+                               filteredpackages.end());
+    }
+    filtercache.insert(filterchain, filteredpackages);
+}
+
+void Program::listorder(vector<PkgId> &order)
+{
+    const string chain = dropfilters(filterchain);
+    const vector<PkgId> *cached = filtercache.find(chain);
+    if (cached != NULL) {
+        order = *cached;
+        return;
+    }
+
+    order.resize(packages.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    /* the first line is the sort spec at clearfilter(), the others are
+       ".spec" sorts */
+    for (size_t pos = 0; pos != string::npos; pos = chain.find('\n', pos + 1)) {
+        const size_t at = (chain.compare(pos, 2, "\n.") == 0) ? pos + 2 : pos;
+        const SortSpec spec(chain.substr(at, chain.find('\n', at) - at));
+        if (spec.empty()) {
+            continue;
+        }
+
+        /* all packages from name order are sorted by a single key already */
+        const SortSpec::Key &first = spec.getkeys()[0];
+        if (pos == 0 && spec.getkeys().size() == 1 && !first.descending) {
+            order = packages.getsorted(first.attr);
+        } else {
+            Filter::sortby(packages, order, spec);
+        }
+    }
+    filtercache.insert(chain, order);
+}
+
 History *Program::gethis(FilterOperationEnum o)
 {
     History *v = NULL;
@@ -431,6 +1013,8 @@ ControlOperationEnum Program::parsectrl(const std::string &str) const
         , { "quit", CTRL_QUIT }
         , { "reload", CTRL_RELOAD }
         , { "filter_clear", CTRL_FILTER_CLEAR }
+        , { "filter_pop", CTRL_FILTER_POP }
+        , { "filter_edit", CTRL_FILTER_EDIT }
     });
 
     try {
@@ -508,12 +1092,17 @@ void Program::execctrl(const ControlOperationEnum op)
         quit = true;
         break;
     case CTRL_RELOAD:
-        deinit();
-        init();
+        reload();
         break;
     case CTRL_FILTER_CLEAR:
         clearfilter();
         break;
+    case CTRL_FILTER_POP:
+        popfilter();
+        break;
+    case CTRL_FILTER_EDIT:
+        editfilter();
+        break;
     case CTRL_NONE:
         return; /* No error handling possible. */
     default:
@@ -556,9 +1145,11 @@ void Program::execmd(const string &str)
 {
     gethis(OP_EXEC)->add(str);
 
+    Profiler::Timer timer("command: exec");
+
     string pkgs = "";
-    for (const Package *p : opqueue) {
-        pkgs += p->getname() + " ";
+    for (PkgId p : opqueue) {
+        pkgs += packages.getname(p) + " ";
     }
 
     const string needle = "%p";
@@ -570,7 +1161,7 @@ void Program::execmd(const string &str)
 
     CursesUi::ui().disable_curses();
     run_cmd(processed_str);
-    CursesUi::ui().enable_curses(&filteredpackages, &opqueue);
+    CursesUi::ui().enable_curses(&packages, &filteredpackages, &opqueue);
 }
 
 void Program::colorcodepackages(const string &str)
@@ -581,6 +1172,8 @@ void Program::colorcodepackages(const string &str)
 
     gethis(OP_COLORCODE)->add(str);
 
+    Profiler::Timer timer("command: colorcode");
+
     AttributeEnum attr = A_NONE;
     uint i = 0;
 
@@ -598,8 +1191,8 @@ void Program::colorcodepackages(const AttributeEnum attr)
 {
     Filter::clearattrs();
 
-    for (auto p : packages) {
-        Filter::assigncol(p, attr);
+    for (PkgId p = 0; p < packages.size(); p++) {
+        Filter::assigncol(packages, p, attr);
     }
 
     state.coloredby = attr;
@@ -611,8 +1204,10 @@ void Program::searchpackages(const string &str)
 
     gethis(OP_SEARCH)->add(str);
 
+    Profiler::Timer timer("command: search");
+
     /* first, split actual search phrase from field prefix */
-    sregex reprefix = sregex::compile("^([A-Za-z]*):(.*)");
+    static const sregex reprefix = sregex::compile("^([A-Za-z]*):(.*)");
     smatch what;
 
     Filter::clearattrs();
@@ -629,30 +1224,27 @@ void Program::searchpackages(const string &str)
         return;
     }
 
-    const auto search_by_phrase = [&searchphrase] (const Package *a) {
-        return Filter::matches(a, searchphrase);
-    };
-
-    /* we start the search at the current package */
-    vector<Package *>::iterator begin = filteredpackages.begin() + CursesUi::ui().list()->focusedindex()
-                                        + 1;
-    vector<Package *>::iterator it;
-
-    it = std::find_if(begin, filteredpackages.end(), search_by_phrase);
-
-    /* if not found (and original search didn't start at beginning) wrap around */
-    if (it == filteredpackages.end() && begin != filteredpackages.begin()) {
-        it = std::find_if(filteredpackages.begin(), filteredpackages.end(),
-                          search_by_phrase);
+    boost::to_lower(searchphrase);
+    if (filteredpackages.size() >= parallelthreshold) {
+        Filter::prepare(packages, true);
     }
 
+    /* we start the search after the current package and wrap around */
+    const size_t found = Filter::find(filteredpackages,
+                                      CursesUi::ui().list()->focusedindex() + 1,
+                                      parallelthreshold, [this, &searchphrase] () {
+        return [this, &searchphrase] (PkgId a) {
+            return Filter::matches(packages, a, searchphrase);
+        };
+    });
+
     /* not found, do nothing */
-    if (it == filteredpackages.end()) {
+    if (found == filteredpackages.size()) {
         return;
     }
 
     /* move focus to found pkg */
-    CursesUi::ui().list()->moveabs(it - filteredpackages.begin());
+    CursesUi::ui().list()->moveabs(found);
 }
 
 void Program::sortpackages(const string &str)
@@ -663,92 +1255,108 @@ void Program::sortpackages(const string &str)
 
     gethis(OP_SORT)->add(str);
 
-    AttributeEnum attr = A_NONE;
-    uint i = 0;
+    Profiler::Timer timer("command: sort");
 
-    while (attr == A_NONE && i < str.length()) {
-        attr = AttributeInfo::chartoattr(str[i]);
-        i++;
+    const SortSpec spec(str);
+    if (spec.empty()) {
+        return;
     }
 
-    if (attr == A_NONE) {
-        return;
+    /* sorts are stable, so sorting by b right after a sorts by b, then a.
+       the last sort of the chain is replaced by such a merged one, which
+       keeps the chain from growing with every sort. */
+    const size_t last = filterchain.rfind('\n');
+    if (last == string::npos) {
+        /* the sort spec at clearfilter() */
+        state.sortedby = SortSpec(spec.str() + filterchain);
+        filterchain = state.sortedby.str();
+    } else if (filterchain.compare(last, 2, "\n.") == 0) {
+        state.sortedby = SortSpec(spec.str() + filterchain.substr(last + 2));
+        filterchain.replace(last + 2, string::npos, state.sortedby.str());
+    } else {
+        state.sortedby = spec;
+        filterchain += "\n." + spec.str();
     }
 
-    state.sortedby = attr;
+    /* sorting the same list the same way gives the same order */
+    const vector<PkgId> *cached = filtercache.find(filterchain);
+    if (cached != NULL) {
+        filteredpackages = *cached;
+        return;
+    }
 
-    std::sort(filteredpackages.begin(), filteredpackages.end(),
-              [attr] (const Package *lhs, const Package *rhs) {
-                  return Filter::cmp(lhs, rhs, attr);
-              });
+    Filter::sortby(packages, filteredpackages, spec);
+    filtercache.insert(filterchain, filteredpackages);
 }
 
-void Program::filterpackages(const string &str)
+void Program::filterpackages(const string &str, const vector<PkgId> *selected)
 {
-    string fieldlist, searchphrase, negate;
-
     gethis(OP_FILTER)->add(str);
 
-    /* first, split actual search phrase from field prefix */
-    sregex reprefix = sregex::compile("^(([A-Za-zq]*)([!]?):)?(.*)");
-    smatch what;
-
-    Filter::clearattrs();
-    if (regex_search(str, what, reprefix)) {
-        fieldlist = what[2];
-        negate = what[3];
-        searchphrase = what[4];
-    } else {
-        throw PcursesException("Could not match filter regex.");
-    }
+    Profiler::Timer timer("command: filter");
+    applyfilter(str, selected);
+}
 
-    /* if search phrase is empty, nothing to do */
-    if (searchphrase.length() == 0) {
-        return;
-    }
+void Program::applyfilter(const string &str, const vector<PkgId> *selected)
+{
+    /* catch invalid regex input and malformed filters by user */
+    try {
+        Query query(packages, str);
 
-    if (!fieldlist.empty()) {
-        Filter::setattrs(fieldlist);
-    }
+        /* if there is nothing to filter by, nothing to do */
+        if (query.empty()) {
+            return;
+        }
 
-    /* if search phrase is alphanumeric only,
-       perform a fast and simple search, else run slower regexp search */
+        /* the same filters on the same list give the same result */
+        const string chain = filterchain + "\n/" + query.str();
+        const vector<PkgId> *cached = filtercache.find(chain);
+        if (selected == nullptr) {
+            selected = cached;
+        }
 
-    sregex resimple = sregex::compile("[:alnum:]+");
+        vector<PkgId> selection;
 
-    /* catch invalid regex input by user */
-    try {
-        if (regex_match(searchphrase, what, resimple)) {
-            const auto matcher_fn = negate.empty() ? &Filter::notmatches
-                                                   : &Filter::matches;
-            const auto find_by_phrase = [&] (const Package *a) {
-                return matcher_fn(a, searchphrase);
-            };
-
-            vector<Package *>::iterator it =
-                std::find_if(filteredpackages.begin(), filteredpackages.end(),
-                             find_by_phrase);
-            while (it != filteredpackages.end()) {
-                filteredpackages.erase(it);
-                it = std::find_if(it, filteredpackages.end(), find_by_phrase);
-            }
+        if (selected != nullptr) {
+            selection = *selected;
         } else {
-            const auto matcher_fn = negate.empty() ? &Filter::notmatchesre
-                                                   : &Filter::matchesre;
-            sregex needle = sregex::compile(searchphrase, icase);
-            const auto find_by_re = [&] (const Package *a) {
-                return matcher_fn(a, needle);
-            };
-
-            vector<Package *>::iterator it =
-                std::find_if(filteredpackages.begin(), filteredpackages.end(),
-                             find_by_re);
-            while (it != filteredpackages.end()) {
-                filteredpackages.erase(it);
-                it = std::find_if(it, filteredpackages.end(), find_by_re);
+            query.plan();
+
+            /* long lists are filtered by several threads, which must not
+               fill any lazily computed values of the store */
+            if (filteredpackages.size() >= parallelthreshold) {
+                query.prepare();
+
+                /* each thread gets its own copy of the query */
+                selection = Filter::select(filteredpackages, parallelthreshold, [&query] () {
+                    const Query copy = query.clone();
+                    return [copy] (PkgId a) {
+                        return copy.matches(a);
+                    };
+                });
+            } else {
+                selection = Filter::select(filteredpackages, [&query] (PkgId a) {
+                    return query.matches(a);
+                });
             }
         }
 
+        if (cached == nullptr) {
+            filtercache.insert(chain, selection);
+        }
+
+        FilterLink link;
+        link.filter = str;
+        link.chainpos = filterchain.length();
+        link.selection.assign(packages.size(), false);
+        for (PkgId a : selection) {
+            link.selection.set(a);
+        }
+        filterstack.push_back(link);
+
+        filterchain = chain;
+        filteredpackages.swap(selection);
+
         if (state.searchphrases.length() != 0) {
             state.searchphrases += ", ";
         }
@@ -758,5 +1366,7 @@ void Program::filterpackages(const string &str)
         CursesUi::ui().list()->moveabs(0);
     } catch (const boost::xpressive::regex_error &e) {
         /* we don't have any decent feedback mechanisms, so ignore faulty regexp */
+    } catch (const PcursesException &e) {
+        /* same for malformed filters */
     }
 }
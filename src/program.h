@@ -18,12 +18,19 @@
 #ifndef PROGRAM_H
 #define PROGRAM_H
 
+#include <alpm.h>
+#include <set>
+
+#include "bitset.h"
 #include "config.h"
 #include "history.h"
+#include "livefilter.h"
+#include "loader.h"
+#include "lrucache.h"
+#include "packagestore.h"
+#include "snapshot.h"
 #include "state.h"
 
-class Package;
-
 class Program
 {
 public:
@@ -36,10 +43,29 @@ public:
 private:
     void run_cmd(const std::string &cmd) const;
     void loadpkgs();
+    void readoptions();
+    void pollloader();
+    void mergedb(LoadedDb &db, PackageStore &from, PackageStore &into);
+    void reload();
+    void updatepkgs(const std::set<std::string> &changed);
+    void replacepackages(PackageStore &fresh);
+    std::map<std::string, std::string> readdbstamps() const;
+    void releasehandles();
     void init_misc();
     void deinit();
+    void resetfilteredpackages();
     void clearfilter();
-    void filterpackages(const std::string &str);
+    void popfilter();
+    void refilter(size_t from);
+    void editfilter();
+    void replacefilter(size_t n, const std::string &str);
+    void truncatefilters(size_t n);
+    void listorder(std::vector<PkgId> &order);
+    void filterpackages(const std::string &str,
+                        const std::vector<PkgId> *selected = nullptr);
+    void applyfilter(const std::string &str, const std::vector<PkgId> *selected = nullptr);
+    void steplivefilter();
+    void stoplivefilter(bool apply);
     void sortpackages(const std::string &str);
     void searchpackages(const std::string &str);
     ControlOperationEnum parsectrl(const std::string &str) const;
@@ -59,12 +85,61 @@ private:
 
     bool quit;
 
-    std::vector<Package *> packages,
-        filteredpackages,
+    /* one per db, keyed by repo name and "local" (see Loader). kept
+       alive while packages exist, they read their details lazily. */
+    std::map<std::string, alpm_handle_t *> handles;
+
+    /* the local db of handles, empty until it has been read */
+    LocalIndex localindex;
+
+    /* reads the dbs in the background if there is no snapshot */
+    Loader loader;
+    std::string loadstamp;
+    bool loading;
+
+    /* state of the dbs the packages were read from, see readdbstamps() */
+    std::map<std::string, std::string> dbstamps;
+
+    /* packages read from the snapshot point into its mapping */
+    Snapshot snapshot;
+
+    PackageStore packages;
+
+    std::vector<PkgId> filteredpackages,
         opqueue;
 
+    /* one link per filter applied since the last clearfilter(), holding
+       the packages left after it. chainpos is the length of filterchain
+       before the filter was added. replayed on reload. */
+    struct FilterLink {
+        std::string filter;
+        size_t chainpos;
+        Bitset selection;
+    };
+    std::vector<FilterLink> filterstack;
+
+    /* the link whose filter is in the input buffer, see editfilter() */
+    bool editing;
+    size_t editlink;
+
+    /* the operations filteredpackages results from: the sort spec at the
+       last clearfilter(), followed by normalized filters and sort specs,
+       one per line. lists of recent chains are cached until the packages
+       change. */
+    std::string filterchain;
+    LruCache<std::string, std::vector<PkgId> > filtercache;
+
+    /* filters the list while a filter is typed, livecursor is where the
+       cursor was before */
+    LiveFilter live;
+    int livecursor;
+
     std::map<std::string, std::string> macros;
 
+    /* filters and searches over at least this many packages are spread
+       across worker threads, see the parallel_threshold option */
+    size_t parallelthreshold;
+
     History hisfilter,
             hissort,
             hissearch,
@@ -0,0 +1,658 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "query.h"
+
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <ctime>
+#include <limits>
+#include <sstream>
+
+#include "filter.h"
+#include "pcursesexception.h"
+#include "regexcache.h"
+
+using boost::xpressive::smatch;
+using boost::xpressive::sregex;
+using std::string;
+using std::vector;
+
+/* "<v", "<=v", ">v" or ">=v", see parserange() */
+static const sregex rerange = sregex::compile("^([<>]=?) *(.+)$");
+
+/* sizes such as "300", "50M" or "1.5 GB" */
+static const sregex resize = sregex::compile("^([0-9]+(\\.[0-9]*)?) *([kmgt]?)(i?b)?$",
+                                             boost::xpressive::regex_constants::icase);
+
+/* dates "2023", "2023-01" and "2023-01-01" */
+static const sregex redate = sregex::compile("^([0-9]{4})(-([0-9]{1,2})(-([0-9]{1,2}))?)?$");
+
+/* relative cost of a regex compared to a substring search */
+static const double regexcost = 8.0;
+
+/* share of packages a term is assumed to match without better knowledge */
+static const double defaultpass = 0.5;
+
+/* cost of looking up a precomputed result */
+static const double bitcost = 0.05;
+
+Query::Query(const PackageStore &store, const string &str)
+    : store(&store),
+      pos(0)
+{
+    tokenize(str, tokens);
+
+    root = parseor();
+    if (pos != tokens.size()) {
+        throw PcursesException("Malformed filter.");
+    }
+
+    vector<string>().swap(tokens);
+}
+
+bool Query::isoperator(const string &token)
+{
+    return token == "AND" || token == "OR" || token == "NOT" ||
+           token == "(" || token == ")";
+}
+
+void Query::tokenize(const string &str, vector<string> &tokens)
+{
+    vector<string> words;
+    boost::split(words, str, boost::is_space(), boost::token_compress_on);
+
+    /* without operators, the whole filter is a single term as before */
+    if (std::none_of(words.begin(), words.end(), [] (const string &w) {
+        return w == "AND" || w == "OR" || w == "NOT";
+    })) {
+        tokens.push_back(str);
+        return;
+    }
+
+    for (string w : words) {
+        /* leading parentheses open groups */
+        while (!w.empty() && w[0] == '(') {
+            tokens.push_back("(");
+            w.erase(0, 1);
+        }
+
+        /* trailing ones close groups unless they close one of the word
+           itself, as in the regex "^(as|exp)" */
+        const long opened = std::count(w.begin(), w.end(), '(');
+        long unmatched = std::count(w.begin(), w.end(), ')') - opened;
+        size_t closed = 0;
+        while (unmatched > 0 && !w.empty() && w[w.length() - 1] == ')') {
+            w.erase(w.length() - 1);
+            unmatched--;
+            closed++;
+        }
+
+        if (!w.empty()) {
+            tokens.push_back(w);
+        }
+        tokens.insert(tokens.end(), closed, ")");
+    }
+}
+
+Query::Node Query::parseor()
+{
+    vector<Node> operands(1, parseand());
+
+    while (pos < tokens.size() && tokens[pos] == "OR") {
+        pos++;
+        operands.push_back(parseand());
+    }
+
+    return combine(N_OR, operands);
+}
+
+Query::Node Query::parseand()
+{
+    vector<Node> operands(1, parsenot());
+
+    while (pos < tokens.size() && tokens[pos] == "AND") {
+        pos++;
+        operands.push_back(parsenot());
+    }
+
+    return combine(N_AND, operands);
+}
+
+Query::Node Query::parsenot()
+{
+    if (pos < tokens.size() && tokens[pos] == "NOT") {
+        pos++;
+
+        vector<Node> operand(1, parsenot());
+        return combine(N_NOT, operand);
+    }
+
+    return parseprimary();
+}
+
+Query::Node Query::parseprimary()
+{
+    if (pos == tokens.size()) {
+        throw PcursesException("Malformed filter.");
+    }
+
+    if (tokens[pos] == "(") {
+        pos++;
+        Node n = parseor();
+        if (pos == tokens.size() || tokens[pos] != ")") {
+            throw PcursesException("Malformed filter.");
+        }
+        pos++;
+        return n;
+    }
+
+    /* words up to the next operator form the term */
+    const size_t first = pos;
+    string str;
+    while (pos < tokens.size() && !isoperator(tokens[pos])) {
+        str += (pos == first ? "" : " ") + tokens[pos];
+        pos++;
+    }
+
+    if (pos == first) {
+        throw PcursesException("Malformed filter.");
+    }
+
+    return maketerm(str);
+}
+
+Query::Node Query::combine(NodeType type, vector<Node> &children)
+{
+    if (type != N_NOT && children.size() == 1) {
+        return children[0];
+    }
+
+    Node n;
+    n.type = type;
+    n.children.swap(children);
+
+    if (type == N_NOT) {
+        n.str = "NOT " + n.children[0].str;
+        return n;
+    }
+
+    vector<string> strs;
+    for (const Node &c : n.children) {
+        strs.push_back(c.str);
+    }
+    std::sort(strs.begin(), strs.end());
+    n.str = "(" + boost::join(strs, (type == N_AND) ? " AND " : " OR ") + ")";
+
+    return n;
+}
+
+Query::Node Query::maketerm(const string &str)
+{
+    Node n;
+    n.type = N_TERM;
+    n.str = Filter::normalize(str);
+
+    Term &t = n.term;
+    string fieldlist;
+    Filter::parse(str, fieldlist, t.negate, t.exact, t.phrase);
+
+    /* same defaults as Filter::clearattrs() */
+    if (fieldlist.empty()) {
+        t.attrs.push_back(A_NAME);
+        t.attrs.push_back(A_DESC);
+    } else {
+        t.attrs = Filter::parseattrs(fieldlist);
+    }
+
+    t.simple = !t.exact && Filter::issimple(t.phrase);
+    t.indexed = false;
+    t.range = !t.exact && isrange(t.phrase, t.attrs);
+    if (t.range) {
+        for (AttributeEnum attr : t.attrs) {
+            off_t lower, upper;
+            if (!parserange(attr, t.phrase, lower, upper)) {
+                throw PcursesException("Malformed filter.");
+            }
+            t.bounds.push_back(std::make_pair(lower, upper));
+        }
+    } else if (t.exact || t.simple) {
+        boost::to_lower(t.phrase);
+    } else if (!t.phrase.empty()) {
+        t.re = std::make_shared<const boost::xpressive::sregex>(
+                   RegexCache::cache().get(t.phrase, true));
+    }
+
+    return n;
+}
+
+bool Query::isrange(const string &phrase, const vector<AttributeEnum> &attrs)
+{
+    return !phrase.empty() && (phrase[0] == '<' || phrase[0] == '>') &&
+           !attrs.empty() && std::all_of(attrs.begin(), attrs.end(), PackageStore::isnumeric);
+}
+
+bool Query::parserange(AttributeEnum attr, const string &phrase, off_t &lower, off_t &upper)
+{
+    smatch what;
+    off_t from, to;
+
+    if (!regex_match(phrase, what, rerange) || !parsevalue(attr, what[2], from, to)) {
+        return false;
+    }
+
+    lower = std::numeric_limits<off_t>::min();
+    upper = std::numeric_limits<off_t>::max();
+
+    if (what[1] == "<") {
+        upper = from - 1;
+    } else if (what[1] == "<=") {
+        upper = to;
+    } else if (what[1] == ">") {
+        lower = to + 1;
+    } else {
+        lower = from;
+    }
+
+    return true;
+}
+
+bool Query::parsevalue(AttributeEnum attr, const string &str, off_t &lower, off_t &upper)
+{
+    smatch what;
+
+    if (attr != A_BUILDDATE) {
+        if (!regex_match(str, what, resize)) {
+            return false;
+        }
+
+        /* not affected by the locale, unlike strtod() */
+        std::istringstream ss(what[1]);
+        double value;
+        ss >> value;
+
+        /* units as shown in the info pane */
+        const string units = "kmgt";
+        const size_t unit = what[3].length() ? units.find(tolower(what.str(3)[0])) + 1 : 0;
+        for (size_t i = 0; i < unit; i++) {
+            value *= 1024.0;
+        }
+
+        lower = upper = (off_t)(value + 0.5);
+        return true;
+    }
+
+    if (!regex_match(str, what, redate)) {
+        return false;
+    }
+
+    /* a date stands for all of the year, month or day, in local time
+       like the build dates shown */
+    struct tm from = tm();
+    from.tm_year = std::stoi(what.str(1)) - 1900;
+    from.tm_mon = what[3].matched ? std::stoi(what.str(3)) - 1 : 0;
+    from.tm_mday = what[5].matched ? std::stoi(what.str(5)) : 1;
+    from.tm_isdst = -1;
+
+    struct tm to = from;
+    if (what[5].matched) {
+        to.tm_mday++;
+    } else if (what[3].matched) {
+        to.tm_mon++;
+    } else {
+        to.tm_year++;
+    }
+
+    lower = mktime(&from);
+    upper = mktime(&to) - 1;
+    return true;
+}
+
+bool Query::empty() const
+{
+    return root.type == N_TERM && root.term.phrase.empty();
+}
+
+void Query::plan()
+{
+    plan(root);
+}
+
+double Query::attrcost(AttributeEnum attr) const
+{
+    switch (attr) {
+    case A_NAME:
+    case A_DESC:
+    case A_REPO:
+    case A_INSTALLSTATE:
+    case A_UPDATESTATE:
+        /* kept in columns of the store */
+        return 1.0;
+    case A_VERSION:
+    case A_SIZE:
+    case A_ISIZE:
+    case A_BUILDDATE:
+        /* formatted once, then cached */
+        return 2.0;
+    default:
+        /* read from the package details */
+        return 4.0;
+    }
+}
+
+void Query::plan(Node &n) const
+{
+    n.bits.reset();
+    n.complete = false;
+
+    if (n.type == N_TERM) {
+        Term &t = n.term;
+
+        /* a term without phrase is ignored, like an empty filter */
+        if (t.phrase.empty()) {
+            n.cost = 0.0;
+            n.pass = 1.0;
+            return;
+        }
+
+        /* both ends of a range are looked up in the sorted packages */
+        if (t.range) {
+            std::shared_ptr<Bitset> bits = std::make_shared<Bitset>(store->size());
+            for (size_t i = 0; i < t.attrs.size(); i++) {
+                const AttributeEnum attr = t.attrs[i];
+                const vector<PkgId> &sorted = store->getsorted(attr);
+
+                auto first = std::lower_bound(sorted.begin(), sorted.end(), t.bounds[i].first,
+                                              [this, attr] (PkgId a, off_t value) {
+                                                  return store->getoffattr(a, attr) < value;
+                                              });
+                auto last = std::upper_bound(first, sorted.end(), t.bounds[i].second,
+                                             [this, attr] (off_t value, PkgId a) {
+                                                 return value < store->getoffattr(a, attr);
+                                             });
+                for (auto it = first; it != last; ++it) {
+                    bits->set(*it);
+                }
+            }
+            if (t.negate) {
+                bits->flip();
+            }
+
+            setbits(n, bits);
+            return;
+        }
+
+        /* the phrase is matched once per distinct value */
+        if (!t.attrs.empty() &&
+            std::all_of(t.attrs.begin(), t.attrs.end(), PackageStore::isfacet)) {
+            std::shared_ptr<Bitset> bits = std::make_shared<Bitset>(store->size());
+            for (AttributeEnum attr : t.attrs) {
+                const FacetIndex &facets = store->getfacets(attr);
+                if (t.exact) {
+                    facets.equals(t.phrase, *bits);
+                } else if (t.simple) {
+                    facets.contains(t.phrase, *bits);
+                } else {
+                    facets.search(*t.re, *bits);
+                }
+            }
+            if (t.negate) {
+                bits->flip();
+            }
+
+            setbits(n, bits);
+            return;
+        }
+
+        double cost = 0.0;
+        for (AttributeEnum attr : t.attrs) {
+            cost += attrcost(attr);
+        }
+
+        n.pass = defaultpass;
+        if (!t.simple) {
+            cost *= regexcost;
+        } else if (!t.attrs.empty()) {
+            /* the trigram indices tell which packages can match at all */
+            std::shared_ptr<vector<bool> > mask(new vector<bool>());
+            t.indexed = Filter::candidates(*store, t.attrs, t.phrase, *mask);
+            if (t.indexed) {
+                const size_t count = std::count(mask->begin(), mask->end(), true);
+                const double share = store->empty() ? 0.0 : (double)count / store->size();
+                t.candidates = mask;
+                n.pass = share;
+                cost = 0.1 + share * cost;
+            }
+        }
+
+        n.cost = cost;
+        if (t.negate) {
+            n.pass = 1.0 - n.pass;
+        }
+        return;
+    }
+
+    for (Node &c : n.children) {
+        plan(c);
+    }
+
+    if (n.type == N_NOT) {
+        const Node &c = n.children[0];
+        if (c.bits && c.complete) {
+            std::shared_ptr<Bitset> bits = std::make_shared<Bitset>(*c.bits);
+            bits->flip();
+            setbits(n, bits);
+            return;
+        }
+
+        n.cost = c.cost;
+        n.pass = 1.0 - c.pass;
+        return;
+    }
+
+    /* operands known for all packages are combined a word at a time */
+    const bool isand = (n.type == N_AND);
+    std::shared_ptr<Bitset> bits;
+    size_t combined = 0;
+    for (const Node &c : n.children) {
+        if (!c.bits || !c.complete) {
+            continue;
+        }
+
+        if (!bits) {
+            bits = std::make_shared<Bitset>(*c.bits);
+        } else if (isand) {
+            *bits &= *c.bits;
+        } else {
+            *bits |= *c.bits;
+        }
+        combined++;
+    }
+
+    if (combined == n.children.size()) {
+        setbits(n, bits);
+        return;
+    }
+    if (combined > 1) {
+        n.bits = bits;
+    }
+
+    /* an AND is decided by the first false operand, an OR by the first true
+       one. operands are ordered by cost per chance of deciding. */
+    const auto rank = [isand] (const Node &c) {
+        const double decides = isand ? 1.0 - c.pass : c.pass;
+        return (decides <= 0.0) ? std::numeric_limits<double>::max() : c.cost / decides;
+    };
+    std::stable_sort(n.children.begin(), n.children.end(),
+                     [&rank] (const Node &lhs, const Node &rhs) {
+                         return rank(lhs) < rank(rhs);
+                     });
+
+    /* chance of getting to the next operand */
+    double reached = 1.0;
+    n.cost = 0.0;
+    for (const Node &c : n.children) {
+        n.cost += reached * c.cost;
+        reached *= isand ? c.pass : 1.0 - c.pass;
+    }
+    n.pass = isand ? reached : 1.0 - reached;
+}
+
+void Query::setbits(Node &n, const std::shared_ptr<const Bitset> &bits) const
+{
+    n.bits = bits;
+    n.complete = true;
+    n.cost = bitcost;
+    n.pass = store->empty() ? 0.0 : (double)bits->count() / store->size();
+}
+
+void Query::prepare() const
+{
+    vector<const Node *> pending(1, &root);
+
+    while (!pending.empty()) {
+        const Node *n = pending.back();
+        pending.pop_back();
+
+        if (n->bits && n->complete) {
+            continue;
+        }
+
+        for (const Node &c : n->children) {
+            pending.push_back(&c);
+        }
+
+        if (n->type != N_TERM || n->term.phrase.empty()) {
+            continue;
+        }
+        for (AttributeEnum attr : n->term.attrs) {
+            store->prepare(attr, n->term.simple || n->term.exact);
+        }
+    }
+}
+
+Query Query::clone() const
+{
+    Query q(*this);
+    recompile(q.root);
+    return q;
+}
+
+void Query::recompile(Node &n)
+{
+    /* the bits decide, neither the node nor its operands are evaluated */
+    if (n.bits && n.complete) {
+        return;
+    }
+
+    for (Node &c : n.children) {
+        recompile(c);
+    }
+
+    if (n.term.re) {
+        n.term.re = std::make_shared<const sregex>(
+                        RegexCache::cache().get(n.term.phrase, true));
+    }
+}
+
+bool Query::eval(const Node &n, PkgId a) const
+{
+    if (n.bits) {
+        const bool set = n.bits->test(a);
+        /* otherwise the operands not in bits decide */
+        if (n.complete || set != (n.type == N_AND)) {
+            return set;
+        }
+    }
+
+    switch (n.type) {
+    case N_AND:
+        for (const Node &c : n.children) {
+            if (!(n.bits && c.complete) && !eval(c, a)) {
+                return false;
+            }
+        }
+        return true;
+    case N_OR:
+        for (const Node &c : n.children) {
+            if (!(n.bits && c.complete) && eval(c, a)) {
+                return true;
+            }
+        }
+        return false;
+    case N_NOT:
+        return !eval(n.children[0], a);
+    default:
+        return matchterm(n.term, a);
+    }
+}
+
+bool Query::matchterm(const Term &t, PkgId a) const
+{
+    if (t.phrase.empty()) {
+        return true;
+    }
+
+    bool found = false;
+    if (t.range) {
+        for (size_t i = 0; i < t.attrs.size() && !found; i++) {
+            const off_t value = store->getoffattr(a, t.attrs[i]);
+            found = (value >= t.bounds[i].first && value <= t.bounds[i].second);
+        }
+    } else if (t.exact) {
+        found = Filter::equals(*store, a, t.attrs, t.phrase);
+    } else if (!t.simple) {
+        found = Filter::matchesre(*store, a, t.attrs, *t.re);
+    } else if (t.indexed && !(*t.candidates)[a]) {
+        found = false;
+    } else {
+        found = Filter::matches(*store, a, t.attrs, t.phrase);
+    }
+
+    return found != t.negate;
+}
+
+bool Query::narrows(const Query &previous) const
+{
+    return previous.empty() || narrows(root, previous.root);
+}
+
+bool Query::narrows(const Node &n, const Node &previous)
+{
+    if (n.str == previous.str) {
+        return true;
+    }
+
+    /* an AND matches no more than any of its operands */
+    if (n.type == N_AND) {
+        for (const Node &c : n.children) {
+            if (narrows(c, previous)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* a package containing the longer phrase also contains the shorter */
+    if (n.type != N_TERM || previous.type != N_TERM) {
+        return false;
+    }
+
+    const Term &t = n.term, &p = previous.term;
+    return t.simple && p.simple && !t.negate && !p.negate &&
+           t.attrs == p.attrs && t.phrase.find(p.phrase) != string::npos;
+}
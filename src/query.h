@@ -0,0 +1,155 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <boost/xpressive/xpressive.hpp>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+#include "attributeinfo.h"
+#include "bitset.h"
+#include "packagestore.h"
+
+/* A filter compiled for evaluation. A filter is either a single term of
+   the form "[attributes][!]:phrase", or terms combined with the operators
+   AND, OR and NOT and grouped with parentheses, e.g.
+
+       r:core AND (n:^lib OR c:library) AND NOT t:explicit
+
+   Words which are not operators belong to the term before them. Before
+   evaluation, plan() estimates cost and selectivity of each term and
+   orders the operands of AND and OR so that cheap and decisive ones are
+   looked at first. Terms on attributes kept in facet indices, ranges of
+   sizes and build dates such as "z:>50M" or "b:<2023-01-01", and any
+   combination of them are computed for all packages at once as bitsets.
+   matches() then evaluates the whole filter for one package, stopping as
+   soon as the outcome is known. */
+class Query
+{
+public:
+    /* Throws regex_error for invalid regexes and PcursesException for
+       malformed filters. */
+    Query(const PackageStore &store, const std::string &str);
+
+    /* True if there is nothing to filter by. */
+    bool empty() const;
+
+    /* The same for all spellings of equivalent filters: attributes are
+       listed once each in a fixed order, simple phrases are lowercase,
+       operands of AND and OR are sorted. */
+    const std::string &str() const
+    {
+        return root.str;
+    }
+
+    /* Must be called before matches(). */
+    void plan();
+
+    /* Computes all lazily cached values of the store matches() needs, so
+       that copies of the query can be evaluated concurrently. */
+    void prepare() const;
+
+    /* Returns a copy of the query to be evaluated by another thread, its
+       regexes taken from the RegexCache for that thread. */
+    Query clone() const;
+
+    bool matches(PkgId a) const
+    {
+        return eval(root, a);
+    }
+
+    /* True if every package matching this query also matches previous. */
+    bool narrows(const Query &previous) const;
+
+private:
+    struct Term {
+        std::vector<AttributeEnum> attrs;
+        /* lowercase if simple or exact */
+        std::string phrase;
+        bool negate,
+             exact,
+             simple,
+             indexed,
+             range;
+        /* inclusive bounds of a range, one pair per attribute */
+        std::vector<std::pair<off_t, off_t> > bounds;
+        /* shared by plain copies of the query, see clone() */
+        std::shared_ptr<const boost::xpressive::sregex> re;
+        /* packages which may contain phrase, see Filter::candidates() */
+        std::shared_ptr<const std::vector<bool> > candidates;
+    };
+
+    enum NodeType {
+        N_AND,
+        N_OR,
+        N_NOT,
+        N_TERM
+    };
+
+    struct Node {
+        NodeType type;
+        std::vector<Node> children;
+        Term term;
+        std::string str;
+        /* estimated cost of evaluating the node for one package and the
+           share of packages it is true for, see plan() */
+        double cost,
+               pass;
+        /* packages the node, or its operands combined where complete is
+           not set, is true for. set by plan() if known for all packages. */
+        std::shared_ptr<const Bitset> bits;
+        bool complete;
+    };
+
+    static void tokenize(const std::string &str, std::vector<std::string> &tokens);
+    static bool isoperator(const std::string &token);
+
+    Node parseor();
+    Node parseand();
+    Node parsenot();
+    Node parseprimary();
+    static Node combine(NodeType type, std::vector<Node> &children);
+    static Node maketerm(const std::string &str);
+    static bool isrange(const std::string &phrase, const std::vector<AttributeEnum> &attrs);
+    static bool parserange(AttributeEnum attr, const std::string &phrase,
+                           off_t &lower, off_t &upper);
+    static bool parsevalue(AttributeEnum attr, const std::string &str,
+                           off_t &lower, off_t &upper);
+
+    void plan(Node &n) const;
+    void setbits(Node &n, const std::shared_ptr<const Bitset> &bits) const;
+    static void recompile(Node &n);
+    double attrcost(AttributeEnum attr) const;
+    bool eval(const Node &n, PkgId a) const;
+    bool matchterm(const Term &t, PkgId a) const;
+    static bool narrows(const Node &n, const Node &previous);
+
+    const PackageStore *store;
+
+    /* used while parsing only */
+    std::vector<std::string> tokens;
+    size_t pos;
+
+    Node root;
+};
+
+#endif // QUERY_H
@@ -0,0 +1,66 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "pcursesexception.h"
+
+/* Helpers for snapshot records, which consist of plain integers in host
+   byte order and length prefixed strings. The readers throw if a value
+   does not fit between pos and end. */
+
+template <typename T>
+inline void putnum(std::string &buf, T n)
+{
+    buf.append((const char *)&n, sizeof(n));
+}
+
+inline void putstr(std::string &buf, const std::string &str)
+{
+    putnum<uint32_t>(buf, str.length());
+    buf.append(str);
+}
+
+template <typename T>
+inline T getnum(const char *&pos, const char *end)
+{
+    T n;
+    if ((size_t)(end - pos) < sizeof(n)) {
+        throw PcursesException("Truncated snapshot record.");
+    }
+    memcpy(&n, pos, sizeof(n));
+    pos += sizeof(n);
+    return n;
+}
+
+inline std::string getstr(const char *&pos, const char *end)
+{
+    const uint32_t len = getnum<uint32_t>(pos, end);
+    if ((size_t)(end - pos) < len) {
+        throw PcursesException("Truncated snapshot record.");
+    }
+    std::string str(pos, len);
+    pos += len;
+    return str;
+}
+
+#endif // RECORD_H
@@ -0,0 +1,68 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "regexcache.h"
+
+#include "profiler.h"
+
+using boost::xpressive::sregex;
+using std::string;
+
+/* Static instance. */
+RegexCache RegexCache::instance;
+
+RegexCache &RegexCache::cache()
+{
+    return instance;
+}
+
+RegexCache::RegexCache()
+    : regexes(64)
+{
+}
+
+sregex RegexCache::get(const string &pattern, bool icase)
+{
+    const string key = (icase ? "i:" : "-:") + pattern;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const sregex *cached = regexes.find(key);
+        if (cached != NULL) {
+            Profiler::profiler().record("regex: cache hit", Profiler::Clock::duration::zero());
+            return *cached;
+        }
+    }
+
+    /* compiled unlocked, two threads may both compile a new pattern */
+    sregex re;
+    {
+        Profiler::Timer timer("regex: compile");
+        re = icase ? sregex::compile(pattern, boost::xpressive::regex_constants::icase)
+             : sregex::compile(pattern);
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    regexes.insert(key, re);
+    return re;
+}
+
+void RegexCache::setcapacity(size_t n)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    regexes.setcapacity(n);
+}
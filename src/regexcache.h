@@ -0,0 +1,53 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef REGEXCACHE_H
+#define REGEXCACHE_H
+
+#include <boost/xpressive/xpressive.hpp>
+#include <mutex>
+#include <string>
+
+#include "lrucache.h"
+
+/* Compiled user regexes by pattern. Filters are repeated through history
+   and macros, so most patterns have been compiled before. Compiles and
+   cache hits are counted by the Profiler. Safe to use from several
+   threads; the returned copies share the compiled pattern, which is not
+   modified by matching. */
+class RegexCache
+{
+public:
+    static RegexCache &cache();
+
+    /* Returns pattern compiled case insensitive if icase is set. Throws
+       regex_error just like sregex::compile(). */
+    boost::xpressive::sregex get(const std::string &pattern, bool icase);
+
+    void setcapacity(size_t n);
+
+private:
+    RegexCache();
+    RegexCache(const RegexCache &);
+
+    static RegexCache instance;
+
+    std::mutex lock;
+    LruCache<std::string, boost::xpressive::sregex> regexes;
+};
+
+#endif // REGEXCACHE_H
@@ -0,0 +1,245 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "snapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "globals.h"
+#include "packagestore.h"
+#include "pcursesexception.h"
+
+using std::string;
+
+/* bump whenever the record layout in PackageStore::serialize() changes */
+#define SNAPSHOT_FORMAT 2
+
+static const char snapshot_magic[8] = { 'P', 'C', 'U', 'R', 'S', 'E', 'S', '\0' };
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t format;
+    uint32_t version;
+    uint32_t stamplen;
+    uint32_t count;
+};
+
+Snapshot::Snapshot()
+    : data(NULL), size(0)
+{
+}
+
+Snapshot::~Snapshot()
+{
+    unload();
+}
+
+void Snapshot::unload()
+{
+    if (data != NULL) {
+        munmap(data, size);
+        data = NULL;
+        size = 0;
+    }
+}
+
+static string filestamp(const string &path)
+{
+    struct stat st;
+    std::stringstream ss;
+
+    if (stat(path.c_str(), &st) != 0) {
+        return "-";
+    }
+
+    ss << st.st_mtim.tv_sec << "." << st.st_mtim.tv_nsec << ":" << st.st_size;
+    return ss.str();
+}
+
+/* package dirs are added and removed on every install, upgrade and
+   removal, which updates the mtime of the local db dir. install reasons
+   are changed by rewriting the desc file of a package in place (pacman -D),
+   which does not, so the newest desc file is part of the stamp as well. */
+static string localstamp(const string &dir)
+{
+    DIR *d = opendir(dir.c_str());
+    if (d == NULL) {
+        return "-";
+    }
+
+    struct timespec newest = { 0, 0 };
+    size_t count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        struct stat st;
+        if (stat((dir + "/" + entry->d_name + "/desc").c_str(), &st) != 0) {
+            continue;
+        }
+
+        count++;
+        if (st.st_mtim.tv_sec > newest.tv_sec ||
+            (st.st_mtim.tv_sec == newest.tv_sec && st.st_mtim.tv_nsec > newest.tv_nsec)) {
+            newest = st.st_mtim;
+        }
+    }
+    closedir(d);
+
+    std::stringstream ss;
+    ss << filestamp(dir) << "/" << count << "/" << newest.tv_sec << "." << newest.tv_nsec;
+    return ss.str();
+}
+
+string Snapshot::dbstamp(const Config &conf, const string &db)
+{
+    return dbstamp(conf.getdbpath(), db);
+}
+
+string Snapshot::dbstamp(const string &dbpath, const string &db)
+{
+    if (db == "local") {
+        return localstamp(dbpath + "/local");
+    }
+
+    return filestamp(dbpath + "/sync/" + db + ".db");
+}
+
+string Snapshot::stamp(const Config &conf)
+{
+    string s = conf.getrootdir() + ";" + conf.getdbpath() + ";";
+
+    for (const string &repo : conf.getrepos()) {
+        s += repo + "=" + dbstamp(conf, repo) + ";";
+    }
+    s += "local=" + dbstamp(conf, "local");
+
+    return s;
+}
+
+bool Snapshot::load(const string &path, const string &stamp, PackageStore &store)
+{
+    unload();
+
+    if (path.empty()) {
+        return false;
+    }
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return false;
+    }
+
+    size = st.st_size;
+    data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        data = NULL;
+        size = 0;
+        return false;
+    }
+
+    const char *pos = (const char *)data;
+    const char *end = pos + size;
+
+    SnapshotHeader hdr;
+    memcpy(&hdr, pos, sizeof(hdr));
+    pos += sizeof(hdr);
+
+    if (memcmp(hdr.magic, snapshot_magic, sizeof(hdr.magic)) != 0
+            || hdr.format != SNAPSHOT_FORMAT || hdr.version != VERSION
+            || hdr.stamplen != stamp.length() || (size_t)(end - pos) < hdr.stamplen
+            || stamp.compare(0, string::npos, pos, hdr.stamplen) != 0) {
+        unload();
+        return false;
+    }
+    pos += hdr.stamplen;
+
+    /* every record takes up way more than a byte */
+    if (hdr.count > (size_t)(end - pos)) {
+        unload();
+        return false;
+    }
+
+    try {
+        store.resize(hdr.count);
+        for (PkgId id = 0; id < hdr.count; id++) {
+            store.deserialize(id, pos, end);
+        }
+    } catch (const PcursesException &) {
+        store.clear();
+        unload();
+        return false;
+    }
+
+    return true;
+}
+
+void Snapshot::save(const string &path, const string &stamp, const PackageStore &store)
+{
+    if (path.empty()) {
+        return;
+    }
+
+    /* create missing parent dirs */
+    for (size_t pos = path.find('/', 1); pos != string::npos; pos = path.find('/', pos + 1)) {
+        mkdir(path.substr(0, pos).c_str(), 0755);
+    }
+
+    SnapshotHeader hdr;
+    memcpy(hdr.magic, snapshot_magic, sizeof(hdr.magic));
+    hdr.format = SNAPSHOT_FORMAT;
+    hdr.version = VERSION;
+    hdr.stamplen = stamp.length();
+    hdr.count = store.size();
+
+    string buf((const char *)&hdr, sizeof(hdr));
+    buf += stamp;
+    for (PkgId id = 0; id < store.size(); id++) {
+        store.serialize(id, buf);
+    }
+
+    /* write to a temporary file first so that a concurrently starting
+       instance never maps a partially written snapshot */
+    const string tmppath = path + ".tmp";
+    FILE *f = fopen(tmppath.c_str(), "wb");
+    if (f == NULL) {
+        return;
+    }
+
+    const bool ok = (fwrite(buf.data(), 1, buf.size(), f) == buf.size());
+    if (fclose(f) != 0 || !ok || rename(tmppath.c_str(), path.c_str()) != 0) {
+        unlink(tmppath.c_str());
+    }
+}
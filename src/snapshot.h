@@ -0,0 +1,61 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+
+class Config;
+class PackageStore;
+
+/* A binary copy of the package list which is written to the cache dir
+   after reading the pacman dbs, and mapped into memory on the next start
+   instead of going through libalpm. It is only used while the dbs it was
+   created from are unchanged (see stamp()). */
+class Snapshot
+{
+public:
+    Snapshot();
+    ~Snapshot();
+
+    /* Maps the snapshot at path and reads its packages into the (empty)
+       store. Returns false and leaves the store empty if there is no
+       snapshot matching the given stamp. */
+    bool load(const std::string &path, const std::string &stamp,
+              PackageStore &store);
+
+    /* Unmaps the snapshot. All packages read from it must be gone. */
+    void unload();
+
+    /* Writes store to path. Errors are ignored, this is only a cache. */
+    static void save(const std::string &path, const std::string &stamp,
+                     const PackageStore &store);
+
+    /* Describes the state of all dbs referenced by conf. */
+    static std::string stamp(const Config &conf);
+
+    /* Describes the state of a single db, either a sync repo or "local". */
+    static std::string dbstamp(const Config &conf, const std::string &db);
+    static std::string dbstamp(const std::string &dbpath, const std::string &db);
+
+private:
+    void *data;
+    size_t size;
+};
+
+#endif // SNAPSHOT_H
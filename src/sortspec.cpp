@@ -0,0 +1,80 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "sortspec.h"
+
+#include <algorithm>
+
+using std::string;
+
+SortSpec::SortSpec(const string &str)
+{
+    bool descending = false;
+
+    for (char c : str) {
+        if (c == '-') {
+            descending = true;
+            continue;
+        }
+
+        const AttributeEnum attr = AttributeInfo::chartoattr(c);
+        if (attr == A_NONE) {
+            continue;
+        }
+
+        if (std::none_of(keys.begin(), keys.end(), [attr] (const Key &k) {
+            return k.attr == attr;
+        })) {
+            Key k;
+            k.attr = attr;
+            k.descending = descending;
+            keys.push_back(k);
+        }
+        descending = false;
+    }
+}
+
+string SortSpec::str() const
+{
+    string s;
+
+    for (const Key &k : keys) {
+        if (k.descending) {
+            s += '-';
+        }
+        s += AttributeInfo::attrtochar(k.attr);
+    }
+
+    return s;
+}
+
+string SortSpec::name() const
+{
+    string s;
+
+    for (const Key &k : keys) {
+        if (!s.empty()) {
+            s += ", ";
+        }
+        s += AttributeInfo::attrname(k.attr);
+        if (k.descending) {
+            s += " (desc)";
+        }
+    }
+
+    return s;
+}
@@ -0,0 +1,64 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef SORTSPEC_H
+#define SORTSPEC_H
+
+#include <string>
+#include <vector>
+
+#include "attributeinfo.h"
+
+/* The attributes to sort by, most significant first. Written as a list
+   of field specifiers, each one preceded by '-' to sort descending,
+   e.g. "r-z" sorts by repo and packages of the same repo by size,
+   largest first. */
+class SortSpec
+{
+public:
+    struct Key {
+        AttributeEnum attr;
+        bool descending;
+    };
+
+    SortSpec() { }
+
+    /* Unknown characters are skipped, as are attributes listed before
+       since they cannot change the order any more. */
+    explicit SortSpec(const std::string &str);
+
+    bool empty() const
+    {
+        return keys.empty();
+    }
+
+    const std::vector<Key> &getkeys() const
+    {
+        return keys;
+    }
+
+    /* the spec in its shortest form, e.g. "r-z" */
+    std::string str() const;
+
+    /* for display, e.g. "Repo, Download size (desc)" */
+    std::string name() const;
+
+private:
+    std::vector<Key> keys;
+};
+
+#endif // SORTSPEC_H
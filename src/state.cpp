@@ -23,7 +23,7 @@ State::
 State()
 {
     mode = MODE_STANDARD;
-    sortedby = A_NAME;
+    sortedby = SortSpec("n");
     coloredby = A_INSTALLSTATE;
     op = OP_NONE;
 }
@@ -22,6 +22,7 @@
 
 #include "inputbuffer.h"
 #include "attributeinfo.h"
+#include "sortspec.h"
 
 enum ModeEnum {
     MODE_STANDARD,
@@ -55,6 +56,8 @@ enum ControlOperationEnum {
     CTRL_QUIT,
     CTRL_RELOAD,
     CTRL_FILTER_CLEAR,
+    CTRL_FILTER_POP,
+    CTRL_FILTER_EDIT,
     CTRL_NONE,
 };
 
@@ -63,9 +66,12 @@ struct State {
 
     ModeEnum mode;
     std::string searchphrases;
+    std::string loadprogress;
+    /* shown in the status bar until the next key press */
+    std::string error;
     InputBuffer inputbuf;
-    AttributeEnum sortedby,
-                  coloredby;
+    SortSpec sortedby;
+    AttributeEnum coloredby;
     FilterOperationEnum op;
 };
 
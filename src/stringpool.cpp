@@ -0,0 +1,70 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "stringpool.h"
+
+using std::string;
+
+/* Static instance. */
+StringPool StringPool::instance;
+
+StringPool &StringPool::pool()
+{
+    return instance;
+}
+
+StringPool::StringPool()
+    : saved(0)
+{
+}
+
+const string *StringPool::intern(const string &str)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto res = strings.insert(str);
+    if (!res.second) {
+        /* a copy would have needed its own string object plus a heap
+           buffer unless it fits the small string optimization */
+        saved += sizeof(string) - sizeof(const string *);
+        if (str.length() > string().capacity()) {
+            saved += str.length() + 1;
+        }
+    }
+
+    return &*res.first;
+}
+
+void StringPool::clear()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    strings.clear();
+    saved = 0;
+}
+
+size_t StringPool::size() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return strings.size();
+}
+
+size_t StringPool::bytessaved() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return saved;
+}
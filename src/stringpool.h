@@ -0,0 +1,58 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+/* Keeps a single immutable copy of strings which repeat across many
+   packages (repo names, architectures, packagers, licenses, ...). Interned
+   strings can be compared by pointer. */
+class StringPool
+{
+public:
+    static StringPool &pool();
+
+    /* Returns the shared copy of str. The pointer is valid until clear().
+       Safe to call from several threads at once. */
+    const std::string *intern(const std::string &str);
+
+    /* Drops all strings. Nothing may reference them anymore. */
+    void clear();
+
+    /* Number of distinct strings in the pool. */
+    size_t size() const;
+
+    /* Approximate number of bytes saved compared to a private copy
+       for every intern() call. */
+    size_t bytessaved() const;
+
+private:
+    StringPool();
+    StringPool(const StringPool &);
+
+    static StringPool instance;
+
+    mutable std::mutex lock;
+    std::unordered_set<std::string> strings;
+    size_t saved;
+};
+
+#endif // STRINGPOOL_H
@@ -0,0 +1,207 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "textsearch.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TEXTSEARCH_X86
+#endif
+
+const TextSearch::Kernel TextSearch::kernel = TextSearch::select();
+
+static inline char lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+/* compares m bytes of s, folded, to the lowercase needle */
+static inline bool equalsfolded(const char *s, const char *needle, size_t m)
+{
+    for (size_t i = 0; i < m; i++) {
+        if (lower(s[i]) != needle[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TextSearch::containsscalar(const char *s, size_t n, const char *needle, size_t m)
+{
+    if (m == 0) {
+        return true;
+    }
+
+    /* the haystack is folded already, so nothing is lowercased here and
+       memchr() skips ahead to candidate positions */
+    const char *end = s + n;
+    while ((size_t)(end - s) >= m) {
+        const char *p = (const char *)memchr(s, needle[0], end - s - m + 1);
+        if (p == NULL) {
+            return false;
+        }
+        if (memcmp(p + 1, needle + 1, m - 1) == 0) {
+            return true;
+        }
+        s = p + 1;
+    }
+    return false;
+}
+
+#ifdef TEXTSEARCH_X86
+
+/* Both vector kernels test a block of candidate positions at once: a
+   position can only start a match if its byte equals the first byte of
+   the needle and the byte m - 1 further equals the last one. Only
+   positions passing both tests are compared in full. The last block is
+   aligned to the end of the string and overlaps the previous one, bits
+   of positions which were already tested are masked out. Upper case
+   letters are folded in-register by adding 0x20 to bytes within 'A'..'Z',
+   which is tested as a signed compare after shifting 'A' to -128. */
+
+static inline bool verify(unsigned int mask, const char *s, const char *needle, size_t m)
+{
+    while (mask != 0) {
+        if (equalsfolded(s + __builtin_ctz(mask), needle, m)) {
+            return true;
+        }
+        mask &= mask - 1;
+    }
+    return false;
+}
+
+__attribute__((target("sse2")))
+static inline __m128i fold128(__m128i x)
+{
+    const __m128i shifted = _mm_add_epi8(x, _mm_set1_epi8((char)(-128 - 'A')));
+    const __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 26)));
+    return _mm_add_epi8(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+__attribute__((target("sse2")))
+static inline unsigned int block128(const char *s, size_t m, __m128i first, __m128i last)
+{
+    const __m128i a = fold128(_mm_loadu_si128((const __m128i *)s));
+    const __m128i b = fold128(_mm_loadu_si128((const __m128i *)(s + m - 1)));
+    return _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+}
+
+__attribute__((target("sse2")))
+static bool containssse2(const char *s, size_t n, const char *needle, size_t m)
+{
+    const size_t width = 16;
+
+    if (m == 0 || n < m + width - 1) {
+        return TextSearch::containsscalar(s, n, needle, m);
+    }
+
+    const size_t positions = n - m + 1;
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+
+    size_t i = 0;
+    for (; i + width <= positions; i += width) {
+        if (verify(block128(s + i, m, first, last), s + i, needle, m)) {
+            return true;
+        }
+    }
+
+    if (i < positions) {
+        const size_t j = positions - width;
+        const unsigned int mask = block128(s + j, m, first, last) & ~((1u << (i - j)) - 1);
+        return verify(mask, s + j, needle, m);
+    }
+
+    return false;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i fold256(__m256i x)
+{
+    const __m256i shifted = _mm256_add_epi8(x, _mm256_set1_epi8((char)(-128 - 'A')));
+    const __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 26)), shifted);
+    return _mm256_add_epi8(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int block256(const char *s, size_t m, __m256i first, __m256i last)
+{
+    const __m256i a = fold256(_mm256_loadu_si256((const __m256i *)s));
+    const __m256i b = fold256(_mm256_loadu_si256((const __m256i *)(s + m - 1)));
+    return _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                                                 _mm256_cmpeq_epi8(b, last)));
+}
+
+__attribute__((target("avx2")))
+static bool containsavx2(const char *s, size_t n, const char *needle, size_t m)
+{
+    const size_t width = 32;
+
+    if (m == 0 || n < m + width - 1) {
+        return containssse2(s, n, needle, m);
+    }
+
+    const size_t positions = n - m + 1;
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+
+    size_t i = 0;
+    for (; i + width <= positions; i += width) {
+        if (verify(block256(s + i, m, first, last), s + i, needle, m)) {
+            return true;
+        }
+    }
+
+    if (i < positions) {
+        const size_t j = positions - width;
+        const unsigned int mask = block256(s + j, m, first, last) & ~((1u << (i - j)) - 1);
+        return verify(mask, s + j, needle, m);
+    }
+
+    return false;
+}
+
+#endif // TEXTSEARCH_X86
+
+TextSearch::Kernel TextSearch::select()
+{
+#ifdef TEXTSEARCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return containsavx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return containssse2;
+    }
+#endif
+    return containsscalar;
+}
+
+const char *TextSearch::kernelname()
+{
+#ifdef TEXTSEARCH_X86
+    if (kernel == containsavx2) {
+        return "avx2";
+    }
+    if (kernel == containssse2) {
+        return "sse2";
+    }
+#endif
+    return "scalar";
+}
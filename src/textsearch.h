@@ -0,0 +1,51 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef TEXTSEARCH_H
+#define TEXTSEARCH_H
+
+#include <cstddef>
+#include <string>
+
+/* Substring search in the folded columns of the store. The implementation
+   is picked once at startup: AVX2 or SSE2 where the cpu supports it,
+   memchr() otherwise. The vector kernels fold ASCII upper case letters
+   in-register as a side effect, the others rely on folded input. */
+class TextSearch
+{
+public:
+    /* haystack and needle must be lowercase. */
+    static bool contains(const std::string &haystack, const std::string &needle)
+    {
+        return kernel(haystack.data(), haystack.length(), needle.data(), needle.length());
+    }
+
+    /* The portable implementation, always available. */
+    static bool containsscalar(const char *s, size_t n, const char *needle, size_t m);
+
+    /* Name of the selected implementation. */
+    static const char *kernelname();
+
+private:
+    typedef bool (*Kernel)(const char *s, size_t n, const char *needle, size_t m);
+
+    static Kernel select();
+
+    static const Kernel kernel;
+};
+
+#endif // TEXTSEARCH_H
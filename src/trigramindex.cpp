@@ -0,0 +1,84 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#include "trigramindex.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+using std::string;
+using std::vector;
+
+void TrigramIndex::build(const vector<string> &column)
+{
+    postings.clear();
+
+    for (uint32_t id = 0; id < column.size(); id++) {
+        const string &s = column[id];
+        for (size_t i = 0; i + 3 <= s.length(); i++) {
+            vector<uint32_t> &ids = postings[key(s.data() + i)];
+            /* ids are visited in order, so duplicates are adjacent */
+            if (ids.empty() || ids.back() != id) {
+                ids.push_back(id);
+            }
+        }
+    }
+
+    built = true;
+}
+
+bool TrigramIndex::candidates(const string &needle, vector<bool> &mask) const
+{
+    if (needle.length() < 3) {
+        return false;
+    }
+
+    vector<const vector<uint32_t> *> lists;
+    for (size_t i = 0; i + 3 <= needle.length(); i++) {
+        auto it = postings.find(key(needle.data() + i));
+        if (it == postings.end()) {
+            /* some trigram occurs nowhere, neither does needle */
+            return true;
+        }
+        lists.push_back(&it->second);
+    }
+
+    /* intersect starting with the shortest list to keep the
+       intermediate results small */
+    std::sort(lists.begin(), lists.end(),
+              [] (const vector<uint32_t> *lhs, const vector<uint32_t> *rhs) {
+                  return (lhs->size() != rhs->size()) ? lhs->size() < rhs->size()
+                                                      : std::less<const vector<uint32_t> *>()(lhs, rhs);
+              });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+    vector<uint32_t> result = *lists[0], next;
+    for (size_t i = 1; i < lists.size() && !result.empty(); i++) {
+        next.clear();
+        std::set_intersection(result.begin(), result.end(),
+                              lists[i]->begin(), lists[i]->end(),
+                              std::back_inserter(next));
+        result.swap(next);
+    }
+
+    for (uint32_t id : result) {
+        mask[id] = true;
+    }
+
+    return true;
+}
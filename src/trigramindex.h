@@ -0,0 +1,63 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Maps every sequence of three bytes to the (ascending) indices of the
+   strings of a column containing it. A substring of at least three bytes
+   can only occur in strings which contain all of its trigrams. */
+class TrigramIndex
+{
+public:
+    TrigramIndex() : built(false) { }
+
+    void build(const std::vector<std::string> &column);
+
+    void clear()
+    {
+        postings.clear();
+        built = false;
+    }
+
+    bool isbuilt() const
+    {
+        return built;
+    }
+
+    /* Sets mask[i] for every string i which may contain needle, and
+       returns false if needle is too short to use the index. */
+    bool candidates(const std::string &needle, std::vector<bool> &mask) const;
+
+private:
+    static uint32_t key(const char *s)
+    {
+        return ((uint32_t)(unsigned char)s[0] << 16) |
+               ((uint32_t)(unsigned char)s[1] << 8) |
+               (uint32_t)(unsigned char)s[2];
+    }
+
+    std::unordered_map<uint32_t, std::vector<uint32_t> > postings;
+    bool built;
+};
+
+#endif // TRIGRAMINDEX_H
@@ -0,0 +1,113 @@
+/* *************************************************************************
+ *  Copyright 2010 Jakob Gruber                                            *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ ************************************************************************* */
+
+/* Checks that a snapshot is rejected once the install reason of a package
+   has been changed in place, as done by pacman -D, which leaves the mtime
+   of the local db dir alone. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/packagestore.h"
+#include "src/snapshot.h"
+
+using std::string;
+
+static bool writefile(const string &path, const char *mode, const string &contents)
+{
+    FILE *f = fopen(path.c_str(), mode);
+    if (f == NULL) {
+        return false;
+    }
+    const bool ok = (fwrite(contents.data(), 1, contents.size(), f) == contents.size());
+    return fclose(f) == 0 && ok;
+}
+
+static bool loads(const string &path, const string &stamp)
+{
+    Snapshot snapshot;
+    PackageStore store;
+    return snapshot.load(path, stamp, store);
+}
+
+int main()
+{
+    char tmpl[] = "/tmp/pcurses-test-XXXXXX";
+    if (mkdtemp(tmpl) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    const string dbpath = tmpl,
+                 local = dbpath + "/local",
+                 pkgdir = local + "/foo-1.0-1",
+                 desc = pkgdir + "/desc",
+                 cache = dbpath + "/packages.cache";
+
+    int failed = 0;
+    if (mkdir(local.c_str(), 0755) != 0 || mkdir(pkgdir.c_str(), 0755) != 0 ||
+        !writefile(desc, "w", "%NAME%\nfoo\n\n%REASON%\n1\n")) {
+        perror("setup");
+        return 1;
+    }
+
+    const string before = Snapshot::dbstamp(dbpath, "local");
+    Snapshot::save(cache, before, PackageStore());
+    if (!loads(cache, before)) {
+        fprintf(stderr, "FAIL: snapshot with unchanged stamp rejected\n");
+        failed++;
+    }
+
+    struct stat dirst;
+    stat(local.c_str(), &dirst);
+
+    /* pacman -D --asexplicit: same file, same size, newer mtime */
+    if (!writefile(desc, "r+", "%NAME%\nfoo\n\n%REASON%\n0\n")) {
+        perror("rewrite");
+        return 1;
+    }
+    struct timespec times[2] = { { 0, UTIME_OMIT }, { dirst.st_mtim.tv_sec + 10, 0 } };
+    utimensat(AT_FDCWD, desc.c_str(), times, 0);
+
+    /* make sure only the desc file tells about the change */
+    struct timespec dirtimes[2] = { { 0, UTIME_OMIT }, dirst.st_mtim };
+    utimensat(AT_FDCWD, local.c_str(), dirtimes, 0);
+
+    const string after = Snapshot::dbstamp(dbpath, "local");
+    if (after == before) {
+        fprintf(stderr, "FAIL: stamp unchanged after rewriting desc\n");
+        failed++;
+    }
+    if (loads(cache, after)) {
+        fprintf(stderr, "FAIL: stale snapshot accepted\n");
+        failed++;
+    }
+
+    unlink(cache.c_str());
+    unlink(desc.c_str());
+    rmdir(pkgdir.c_str());
+    rmdir(local.c_str());
+    rmdir(dbpath.c_str());
+
+    if (failed == 0) {
+        printf("snapshot: ok\n");
+    }
+    return failed == 0 ? 0 : 1;
+}